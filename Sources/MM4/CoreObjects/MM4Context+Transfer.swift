@@ -0,0 +1,125 @@
+//
+//  MM4Context+Transfer.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import Dispatch
+import OpenMM
+
+extension MM4Context {
+  /// Write positions and velocities into the context, reusing the persistent
+  /// transfer buffers.
+  ///
+  /// Reordering and the conversion from FP32 to FP64 happen in the same pass
+  /// over the atoms. Virtual sites are placed at their averaged position, so
+  /// the first force evaluation does not see stale virtual sites.
+  ///
+  /// OpenMM averages the positions of a virtual site's parents without
+  /// considering periodic images. In a periodic system, each hydrogen is moved
+  /// to the image nearest its parent atom, so bonds that cross the boundary
+  /// do not misplace the virtual site.
+  func setPositionsAndVelocities(
+    _ positions: [SIMD3<Float>],
+    _ velocities: [SIMD3<Float>],
+    system: MM4System
+  ) {
+    let atomCount = system.reorderedIndices.count
+    guard positions.count == atomCount,
+          velocities.count == atomCount else {
+      fatalError("Position or velocity count does not match atom count.")
+    }
+    
+    let arrayP = positionsBuffer
+    let arrayV = velocitiesBuffer
+    MM4Context.withTransferTasks(count: atomCount) { range in
+      for original in range {
+        let reordered = Int(system.reorderedIndices[original])
+        arrayP[reordered] = SIMD3<Double>(positions[original])
+        arrayV[reordered] = SIMD3<Double>(velocities[original])
+      }
+    }
+    MM4Context.withTransferTasks(count: system.virtualSiteCount) { range in
+      for virtualSiteID in range {
+        let parents = system.virtualSiteParents[virtualSiteID]
+        let weight = system.virtualSiteWeights[virtualSiteID]
+        let other = positions[Int(parents[0])]
+        var hydrogen = positions[Int(parents[1])]
+        if system.boxVectors != nil {
+          hydrogen = other + system.minimumImage(hydrogen - other)
+          let hydrogenID = Int(system.reorderedIndices[Int(parents[1])])
+          arrayP[hydrogenID] = SIMD3<Double>(hydrogen)
+        }
+        let position = other + weight * (hydrogen - other)
+        
+        let reordered = system.virtualSiteReorder(Int(parents[1]))
+        arrayP[reordered] = SIMD3<Double>(position)
+        arrayV[reordered] = .zero
+      }
+    }
+    context.positions = arrayP
+    context.velocities = arrayV
+  }
+  
+  /// Convert an OpenMM array to single precision, mapping from reordered to
+  /// original indices in the same pass.
+  static func convert(
+    _ input: OpenMM_Vec3Array, system: MM4System
+  ) -> [SIMD3<Float>] {
+    let atomCount = system.reorderedIndices.count
+    return [SIMD3<Float>](unsafeUninitializedCapacity: atomCount) {
+      let baseAddress = $0.baseAddress
+      withTransferTasks(count: atomCount) { range in
+        for original in range {
+          // original -> reordered -> original
+          let reordered = Int(system.reorderedIndices[original])
+          let element = SIMD3<Float>(input[reordered])
+          baseAddress.unsafelyUnwrapped[original] = element
+        }
+      }
+      $1 = atomCount
+    }
+  }
+  
+  /// Convert an OpenMM array to single precision, overwriting an existing
+  /// array instead of allocating a new one.
+  static func convert(
+    _ input: OpenMM_Vec3Array,
+    system: MM4System,
+    into output: inout [SIMD3<Float>]
+  ) {
+    let atomCount = system.reorderedIndices.count
+    if output.count != atomCount {
+      output = Array(repeating: .zero, count: atomCount)
+    }
+    output.withUnsafeMutableBufferPointer {
+      let baseAddress = $0.baseAddress
+      withTransferTasks(count: atomCount) { range in
+        for original in range {
+          let reordered = Int(system.reorderedIndices[original])
+          let element = SIMD3<Float>(input[reordered])
+          baseAddress.unsafelyUnwrapped[original] = element
+        }
+      }
+    }
+  }
+  
+  /// Split a loop over atoms into tasks large enough to amortize the cost of
+  /// dispatching them. Small systems run on the calling thread.
+  static func withTransferTasks(
+    count: Int, _ closure: (Range<Int>) -> Void
+  ) {
+    let taskSize = 4096
+    let taskCount = (count + taskSize - 1) / taskSize
+    guard taskCount > 1 else {
+      closure(0..<count)
+      return
+    }
+    DispatchQueue.concurrentPerform(iterations: taskCount) { z in
+      let start = z * taskSize
+      let end = min(start + taskSize, count)
+      closure(start..<end)
+    }
+  }
+}
@@ -13,14 +13,31 @@ class MM4Context {
   var context: OpenMM_Context
   var integrators: [MM4IntegratorDescriptor: Int] = [:]
   
-  init(system: MM4System, platform: OpenMM_Platform?) {
+  /// The number of inner steps shared by every integrator variant.
+  var innerStepCount: Int
+  
+  /// Persistent buffer for transferring positions into the context.
+  var positionsBuffer: OpenMM_Vec3Array
+  
+  /// Persistent buffer for transferring velocities into the context.
+  var velocitiesBuffer: OpenMM_Vec3Array
+  
+  init(system: MM4System, descriptor: MM4ForceFieldDescriptor) {
     self.compoundIntegrator = OpenMM_CompoundIntegrator()
+    self.innerStepCount = descriptor.innerStepCount
+    
+    // Allocate the transfer buffers once, with one element per particle
+    // (including virtual sites).
+    let particleCount = system.originalIndices.count
+    self.positionsBuffer = OpenMM_Vec3Array(size: particleCount)
+    self.velocitiesBuffer = OpenMM_Vec3Array(size: particleCount)
     
     for start in [false, true] {
       for end in [false, true] {
         var descriptor = MM4IntegratorDescriptor()
         descriptor.start = start
         descriptor.end = end
+        descriptor.innerStepCount = innerStepCount
         
         let integrator = MM4Integrator(descriptor: descriptor)
         integrator.integrator.transfer()
@@ -29,23 +46,44 @@ class MM4Context {
       }
     }
     
-    if let platform {
+    var properties = descriptor.platformProperties
+    if let threadCount = descriptor.threadCount {
+      guard threadCount > 0 else {
+        fatalError("Thread count must be positive.")
+      }
+      properties["Threads"] = String(threadCount)
+    }
+    
+    if let platform = descriptor.platform, !properties.isEmpty {
+      let propertyMap = OpenMM_PropertyMap()
+      for (name, value) in properties {
+        propertyMap[name] = value
+      }
+      self.context = OpenMM_Context(
+        system: system.system,
+        integrator: compoundIntegrator,
+        platform: platform,
+        properties: propertyMap)
+    } else if let platform = descriptor.platform {
       self.context = OpenMM_Context(
         system: system.system,
         integrator: compoundIntegrator,
         platform: platform)
+    } else if !properties.isEmpty {
+      fatalError("Platform properties were specified without a platform.")
     } else {
       self.context = OpenMM_Context(
         system: system.system,
         integrator: compoundIntegrator)
     }
-    
   }
   
   var currentIntegrator: MM4IntegratorDescriptor {
     get { fatalError("Not implemented.") }
     set {
-      guard let index = integrators[newValue] else {
+      var key = newValue
+      key.innerStepCount = innerStepCount
+      guard let index = integrators[key] else {
         fatalError("This should never happen.")
       }
       compoundIntegrator.currentIntegrator = index
@@ -58,4 +96,35 @@ class MM4Context {
     compoundIntegrator.stepSize = timeStep
     compoundIntegrator.step(steps)
   }
+  
+  /// Take several outer steps with the same time step.
+  ///
+  /// - Parameter start: Whether velocities are synchronized with positions
+  ///   before the first step.
+  /// - Parameter end: Whether velocities should be synchronized with positions
+  ///   after the last step.
+  func step(_ steps: Int, timeStep: Double, start: Bool, end: Bool) {
+    guard steps > 0 else {
+      return
+    }
+    var descriptor = MM4IntegratorDescriptor()
+    descriptor.start = start
+    descriptor.end = end && steps == 1
+    currentIntegrator = descriptor
+    step(1, timeStep: timeStep)
+    
+    if steps > 2 {
+      descriptor.start = false
+      descriptor.end = false
+      currentIntegrator = descriptor
+      step(steps - 2, timeStep: timeStep)
+    }
+    
+    if steps > 1 {
+      descriptor.start = false
+      descriptor.end = end
+      currentIntegrator = descriptor
+      step(1, timeStep: timeStep)
+    }
+  }
 }
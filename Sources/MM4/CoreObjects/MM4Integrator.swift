@@ -17,6 +17,10 @@ struct MM4IntegratorDescriptor: Hashable {
   /// intervals.
   var end: Bool = false
   
+  /// The number of inner steps for force group 2, per outer step of force
+  /// group 1.
+  var innerStepCount: Int = 2
+  
   init() {
     
   }
@@ -26,7 +30,8 @@ struct MM4IntegratorDescriptor: Hashable {
     rhs: MM4IntegratorDescriptor
   ) -> Bool {
     guard lhs.start == rhs.start,
-          lhs.end == rhs.end else {
+          lhs.end == rhs.end,
+          lhs.innerStepCount == rhs.innerStepCount else {
       return false
     }
     return true
@@ -35,6 +40,7 @@ struct MM4IntegratorDescriptor: Hashable {
   func hash(into hasher: inout Hasher) {
     hasher.combine(start)
     hasher.combine(end)
+    hasher.combine(innerStepCount)
   }
 }
 
@@ -42,38 +48,51 @@ class MM4Integrator {
   var integrator: OpenMM_CustomIntegrator
   
   /// Create an integrator using the specified configuration.
+  ///
+  /// This is r-RESPA with two levels. Force group 1 is evaluated once per
+  /// outer step (`dt`). Force group 2 is evaluated once per inner step
+  /// (`dt / innerStepCount`). Adjacent half-kicks are fused across step
+  /// boundaries, so the start and end variants restore the synchronized
+  /// velocities at the edges of an integration interval.
   init(descriptor: MM4IntegratorDescriptor) {
+    guard descriptor.innerStepCount >= 1 else {
+      fatalError("Inner step count must be at least one.")
+    }
     self.integrator = OpenMM_CustomIntegrator(stepSize: 0)
     
+    // The inner time step, as a fraction of the outer time step.
+    let h = 1 / Double(descriptor.innerStepCount)
+    
     if descriptor.start {
       integrator.addComputePerDof(variable: "v", expression: """
         v + 0.5 * dt * f1 / m
         """)
       integrator.addComputePerDof(variable: "v", expression: """
-        v + 0.25 * dt * f2 / m
+        v + \(0.5 * h) * dt * f2 / m
         """)
     } else {
       integrator.addComputePerDof(variable: "v", expression: """
         v + 1.0 * dt * f1 / m
         """)
       integrator.addComputePerDof(variable: "v", expression: """
-        v + 0.5 * dt * f2 / m
+        v + \(h) * dt * f2 / m
         """)
     }
     
-    integrator.addComputePerDof(variable: "x", expression: """
-      x + 0.5 * dt * v
-      """)
-    integrator.addComputePerDof(variable: "v", expression: """
-      v + 0.5 * dt * f2 / m
-      """)
-    integrator.addComputePerDof(variable: "x", expression: """
-      x + 0.5 * dt * v
-      """)
+    for innerStepID in 0..<descriptor.innerStepCount {
+      integrator.addComputePerDof(variable: "x", expression: """
+        x + \(h) * dt * v
+        """)
+      if innerStepID < descriptor.innerStepCount - 1 {
+        integrator.addComputePerDof(variable: "v", expression: """
+          v + \(h) * dt * f2 / m
+          """)
+      }
+    }
     
     if descriptor.end {
       integrator.addComputePerDof(variable: "v", expression: """
-        v + 0.25 * dt * f2 / m
+        v + \(0.5 * h) * dt * f2 / m
         """)
       integrator.addComputePerDof(variable: "v", expression: """
         v + 0.5 * dt * f1 / m
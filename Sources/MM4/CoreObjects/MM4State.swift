@@ -85,11 +85,7 @@ extension MM4ForceField {
     // Convert the OpenMM array to a different data type, and map from reordered
     // to original indices.
     func convertArray(_ input: OpenMM_Vec3Array) -> [SIMD3<Float>] {
-      // original -> reordered -> original
-      system.reorderedIndices.map {
-        let index = Int($0)
-        return SIMD3<Float>(input[index])
-      }
+      MM4Context.convert(input, system: system)
     }
     
     let state = MM4State()
@@ -0,0 +1,68 @@
+//
+//  MM4System+Reordering.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+extension MM4System {
+  /// Sort the atoms along a Morton curve, so atoms that are close in space
+  /// are also close in memory.
+  ///
+  /// Returns the original indices in their new order. If the positions are
+  /// not known, the original order is kept.
+  ///
+  /// Hydrogens inherit the code of the atom they are bonded to. This keeps a
+  /// hydrogen's virtual site in the same block of particles as its parent
+  /// atom.
+  func createSpatialOrder(positions: [SIMD3<Float>]?) -> [UInt32] {
+    let atomCount = parameters.atoms.count
+    guard let positions, positions.count == atomCount, atomCount > 0 else {
+      return (0..<UInt32(truncatingIfNeeded: atomCount)).map { $0 }
+    }
+    
+    var minimum = positions[0]
+    var maximum = positions[0]
+    for position in positions {
+      minimum.replace(with: position, where: position .< minimum)
+      maximum.replace(with: position, where: position .> maximum)
+    }
+    
+    // Use the same scale along every axis, so cells are cubes.
+    let extent = (maximum - minimum).max()
+    let scale = (extent > 0) ? Float(1023) / extent : 0
+    
+    var keys: [UInt64] = []
+    keys.reserveCapacity(atomCount)
+    for atomID in 0..<atomCount {
+      var sourceID = atomID
+      if parameters.atoms.atomicNumbers[atomID] == 1 {
+        let map = parameters.atomsToAtomsMap[atomID]
+        if map[0] != -1 {
+          sourceID = Int(map[0])
+        }
+      }
+      
+      var scaled = (positions[sourceID] - minimum) * scale
+      scaled.replace(with: 0, where: .!(scaled .>= 0))
+      scaled.replace(with: 1023, where: scaled .> 1023)
+      let cell = SIMD3<UInt32>(scaled.rounded(.down))
+      let code = MM4System.createMortonCode(cell)
+      keys.append(UInt64(code) << 32 | UInt64(atomID))
+    }
+    keys.sort()
+    
+    return keys.map { UInt32(truncatingIfNeeded: $0) }
+  }
+  
+  /// Interleave the lower 10 bits of each coordinate.
+  @inline(__always)
+  static func createMortonCode(_ cell: SIMD3<UInt32>) -> UInt32 {
+    var spread = cell & 0x3FF
+    spread = (spread | (spread &<< 16)) & 0x030000FF
+    spread = (spread | (spread &<< 8)) & 0x0300F00F
+    spread = (spread | (spread &<< 4)) & 0x030C30C3
+    spread = (spread | (spread &<< 2)) & 0x09249249
+    return spread.x | (spread.y &<< 1) | (spread.z &<< 2)
+  }
+}
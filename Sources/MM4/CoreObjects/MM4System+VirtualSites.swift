@@ -8,7 +8,7 @@
 import OpenMM
 
 extension MM4System {
-  func createReorderedIndices() {
+  func createReorderedIndices(positions: [SIMD3<Float>]?) {
     let atomicNumbers = parameters.atoms.atomicNumbers
     for originalID in 0..<atomicNumbers.count {
       if atomicNumbers[originalID] == 1 {
@@ -17,23 +17,29 @@ extension MM4System {
     }
     
     let particleCount = virtualSiteCount + atomicNumbers.count
+    self.nonbondedIndices = Array(repeating: .max, count: atomicNumbers.count)
     self.reorderedIndices = Array(repeating: .max, count: atomicNumbers.count)
     self.originalIndices = Array(repeating: .max, count: particleCount)
     
+    // Hydrogens come first, followed by heavy atoms and virtual sites. Both
+    // groups follow the spatial order.
+    let spatialOrder = createSpatialOrder(positions: positions)
     var virtualSitePointer = 0
-    for originalID in 0..<atomicNumbers.count {
-      if atomicNumbers[originalID] == 1 {
+    for (rank, originalID) in spatialOrder.enumerated() {
+      let nonbondedID = virtualSiteCount + rank
+      nonbondedIndices[Int(originalID)] = UInt32(
+        truncatingIfNeeded: nonbondedID)
+      originalIndices[nonbondedID] = originalID
+      
+      if atomicNumbers[Int(originalID)] == 1 {
         let reorderedID = virtualSitePointer
         virtualSitePointer += 1
-        reorderedIndices[originalID] = UInt32(truncatingIfNeeded: reorderedID)
-        originalIndices[reorderedID] = UInt32(truncatingIfNeeded: originalID)
-        
-        let virtualSiteID = virtualSiteCount + originalID
-        originalIndices[virtualSiteID] = UInt32(truncatingIfNeeded: originalID)
+        reorderedIndices[Int(originalID)] = UInt32(
+          truncatingIfNeeded: reorderedID)
+        originalIndices[reorderedID] = originalID
       } else {
-        let reorderedID = virtualSiteCount + originalID
-        reorderedIndices[originalID] = UInt32(truncatingIfNeeded: reorderedID)
-        originalIndices[reorderedID] = UInt32(truncatingIfNeeded: originalID)
+        reorderedIndices[Int(originalID)] = UInt32(
+          truncatingIfNeeded: nonbondedID)
       }
     }
     guard virtualSitePointer == virtualSiteCount else {
@@ -59,6 +65,8 @@ extension MM4System {
   }
   
   func createVirtualSites() {
+    virtualSiteParents.reserveCapacity(virtualSiteCount)
+    virtualSiteWeights.reserveCapacity(virtualSiteCount)
     for index in 0..<virtualSiteCount {
       let originalID = originalIndices[index]
       let map = parameters.atomsToBondsMap[Int(originalID)]
@@ -73,34 +81,31 @@ extension MM4System {
       let otherParameters = parameters.atoms.parameters[Int(otherID)]
       let reductionFactor = Double(otherParameters.hydrogenReductionFactor)
       let weights = SIMD2(1 - reductionFactor, reductionFactor)
+      virtualSiteParents.append(
+        SIMD2(UInt32(truncatingIfNeeded: otherID), originalID))
+      virtualSiteWeights.append(Float(reductionFactor))
       
       let reordered = self.reorder(SIMD2(
         UInt32(truncatingIfNeeded: otherID), originalID))
       let virtualSite = OpenMM_TwoParticleAverageSite(
         particles: reordered, weights: weights)
-      let virtualSiteID = virtualSiteCount + Int(originalID)
+      let virtualSiteID = Int(nonbondedIndices[Int(originalID)])
       system.setVirtualSite(virtualSite, index: virtualSiteID)
     }
   }
-  
-  func createVirtualSiteMask() {
-    virtualSiteMask.reserveCapacity(reorderedIndices.count)
-    for reorderedID in reorderedIndices.indices {
-      if reorderedID >= virtualSiteCount {
-        let originalID = Int(originalIndices[reorderedID])
-        let atomicNumber = parameters.atoms.atomicNumbers[originalID]
-        if atomicNumber == 1 {
-          virtualSiteMask.append(false)
-          continue
-        }
-      }
-      virtualSiteMask.append(true)
-    }
-  }
 }
 
 extension MM4System {
-  func createExceptions(force: OpenMM_CustomNonbondedForce) {
+  /// Exclude the 1-2 and 1-3 pairs.
+  ///
+  /// If `atomIDs` is specified, only pairs of the listed atoms interact. Use
+  /// this for small subsets of the atoms. Interaction groups bypass the
+  /// standard neighbor list, so a force spanning every atom should mask
+  /// particles through its parameters instead. Pairs of anchors are omitted
+  /// from the group when anchor interactions are omitted.
+  func createExceptions(
+    force: OpenMM_CustomNonbondedForce, atomIDs: [Int]? = nil
+  ) {
     for bond in parameters.bonds.indices {
       let reordered = self.virtualSiteReorder(bond)
       force.addExclusion(particles: reordered)
@@ -110,32 +115,41 @@ extension MM4System {
       force.addExclusion(particles: reordered)
     }
     
+    guard let atomIDs else {
+      return
+    }
     let group = OpenMM_IntSet()
-    for atomID in parameters.atoms.indices {
+    let movingGroup = OpenMM_IntSet()
+    for atomID in atomIDs {
       let reordered = self.virtualSiteReorder(atomID)
       group.insert(reordered)
+      if anchorMask.isEmpty || !anchorMask[atomID] {
+        movingGroup.insert(reordered)
+      }
     }
-    force.addInteractionGroup(set1: group, set2: group)
+    force.addInteractionGroup(set1: movingGroup, set2: group)
   }
   
   @_transparent
   func virtualSiteReorder(_ index: Int) -> Int {
-    return virtualSiteCount + index
+    return Int(nonbondedIndices[index])
   }
   
   @_transparent
   func virtualSiteReorder(_ indices: SIMD2<UInt32>) -> SIMD2<Int> {
-    var output: SIMD2<UInt32> = indices
-    let virtualSiteCount = UInt32(truncatingIfNeeded: virtualSiteCount)
-    output &+= SIMD2(repeating: virtualSiteCount)
+    var output: SIMD2<UInt32> = .zero
+    for i in 0..<indices.scalarCount {
+      output[i] = nonbondedIndices[Int(indices[i])]
+    }
     return SIMD2<Int>(truncatingIfNeeded: output)
   }
   
   @_transparent
   func virtualSiteReorder(_ indices: SIMD4<UInt32>) -> SIMD4<Int> {
-    var output: SIMD4<UInt32> = indices
-    let virtualSiteCount = UInt32(truncatingIfNeeded: virtualSiteCount)
-    output &+= SIMD4(repeating: virtualSiteCount)
+    var output: SIMD4<UInt32> = .zero
+    for i in 0..<indices.scalarCount {
+      output[i] = nonbondedIndices[Int(indices[i])]
+    }
     return SIMD4<Int>(truncatingIfNeeded: output)
   }
 }
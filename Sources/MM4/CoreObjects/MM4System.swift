@@ -11,37 +11,74 @@ import OpenMM
 ///
 /// This object takes ownership of the `parameters` passed in.
 class MM4System {
+  /// Whether each atom is an anchor whose interactions with other anchors are
+  /// omitted. Empty unless the force field omits anchor interactions.
+  var anchorMask: [Bool] = []
+  
+  /// The vectors spanning the periodic cell, if the system is periodic.
+  var boxVectors: (a: SIMD3<Float>, b: SIMD3<Float>, c: SIMD3<Float>)?
+  
   /// The forces used by the system.
   var forces: MM4Forces!
   
+  /// Map from original indices to the particles seen by nonbonded forces.
+  ///
+  /// For hydrogens, these are the virtual sites.
+  var nonbondedIndices: [UInt32] = []
+  
   /// Map from reordered indices to original indices.
   var originalIndices: [UInt32] = []
   
   /// The location where the parameters are owned.
   var parameters: MM4Parameters
   
-  /// Indices may eventually be rearranged for performance.
+  /// Map from original indices to reordered indices.
+  ///
+  /// Atoms are sorted along a space-filling curve when the initial positions
+  /// are known, so the neighbor list and force kernels access memory
+  /// coherently.
   var reorderedIndices: [UInt32] = []
   
+  /// The torsions evaluated together, around the same central bond.
+  lazy var torsionFusion = MM4TorsionFusion(parameters: parameters)
+  
   /// The backing OpenMM system object.
   var system: OpenMM_System
   
   /// The number of virtual sites.
   var virtualSiteCount: Int = 0
   
-  /// Whether each atom is a virtual site.
-  var virtualSiteMask: [Bool] = []
+  /// The original indices of the heavy atom and hydrogen that define each
+  /// virtual site.
+  var virtualSiteParents: [SIMD2<UInt32>] = []
+  
+  /// The weight of the hydrogen when averaging each virtual site's position.
+  var virtualSiteWeights: [Float] = []
   
-  init(parameters: MM4Parameters, descriptor: MM4ForceFieldDescriptor) {
+  init(
+    parameters: MM4Parameters,
+    positions: [SIMD3<Float>]?,
+    descriptor: MM4ForceFieldDescriptor
+  ) {
     // Initialize base properties.
     self.system = OpenMM_System()
     self.parameters = parameters
+    self.boxVectors = descriptor.boxVectors
+    if let boxVectors {
+      system.setDefaultPeriodicBoxVectors(
+        a: SIMD3<Double>(boxVectors.a),
+        b: SIMD3<Double>(boxVectors.b),
+        c: SIMD3<Double>(boxVectors.c))
+    }
+    
+    if descriptor.omitsAnchorInteractions {
+      anchorMask = parameters.atoms.masses.map { $0 == 0 }
+    }
     
     // Create virtual sites.
-    self.createReorderedIndices()
+    self.createReorderedIndices(positions: positions)
     self.createMasses()
     self.createVirtualSites()
-    self.createVirtualSiteMask()
     
     // Create force objects.
     self.forces = MM4Forces(system: self, descriptor: descriptor)
@@ -49,12 +86,45 @@ class MM4System {
   }
 }
 
+extension MM4System {
+  /// Whether every atom in the group is an anchor, when anchor interactions
+  /// are omitted. Lanes containing `UInt32.max` are ignored.
+  @inline(__always)
+  func isFrozen<T: SIMD>(_ group: T) -> Bool where T.Scalar == UInt32 {
+    guard !anchorMask.isEmpty else {
+      return false
+    }
+    for lane in 0..<T.scalarCount where group[lane] != UInt32.max {
+      if !anchorMask[Int(group[lane])] {
+        return false
+      }
+    }
+    return true
+  }
+  
+  /// Shift a displacement to its shortest periodic image.
+  ///
+  /// Returns the displacement unchanged if the system is not periodic. Relies
+  /// on the box vectors being in reduced form.
+  @inline(__always)
+  func minimumImage(_ delta: SIMD3<Float>) -> SIMD3<Float> {
+    guard let boxVectors else {
+      return delta
+    }
+    var output = delta
+    output -= boxVectors.c * (output.z / boxVectors.c.z).rounded()
+    output -= boxVectors.b * (output.y / boxVectors.b.y).rounded()
+    output -= boxVectors.a * (output.x / boxVectors.a.x).rounded()
+    return output
+  }
+}
+
 extension MM4System {
   @_transparent
   func reorder(_ indices: SIMD2<UInt32>) -> SIMD2<Int> {
     var output: SIMD2<UInt32> = .zero
     for i in 0..<indices.scalarCount {
-      output[i] = reorderedIndices[Int(output[i])]
+      output[i] = reorderedIndices[Int(indices[i])]
     }
     return SIMD2(truncatingIfNeeded: output)
   }
@@ -63,7 +133,7 @@ extension MM4System {
   func reorder(_ indices: SIMD3<UInt32>) -> SIMD3<Int> {
     var output: SIMD3<UInt32> = .zero
     for i in 0..<indices.scalarCount {
-      output[i] = reorderedIndices[Int(output[i])]
+      output[i] = reorderedIndices[Int(indices[i])]
     }
     return SIMD3(truncatingIfNeeded: output)
   }
@@ -72,7 +142,7 @@ extension MM4System {
   func reorder(_ indices: SIMD4<UInt32>) -> SIMD4<Int> {
     var output: SIMD4<UInt32> = .zero
     for i in 0..<indices.scalarCount {
-      output[i] = reorderedIndices[Int(output[i])]
+      output[i] = reorderedIndices[Int(indices[i])]
     }
     return SIMD4(truncatingIfNeeded: output)
   }
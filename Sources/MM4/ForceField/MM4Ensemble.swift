@@ -0,0 +1,192 @@
+//
+//  MM4Ensemble.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import Dispatch
+import Foundation
+
+/// A configuration for an ensemble of replicas.
+public struct MM4EnsembleDescriptor {
+  /// Required. The configuration of each replica's force field.
+  ///
+  /// The default value is the default force field descriptor. Every replica
+  /// shares one copy of the parameters.
+  public var forceField: MM4ForceFieldDescriptor = MM4ForceFieldDescriptor()
+  
+  /// Required. The partitioning of thermal energy, in kT per atom.
+  ///
+  /// The default value is 1.5. See
+  /// <doc:MM4RigidBody/setThermalKineticEnergy(temperature:heatCapacity:)>.
+  public var heatCapacity: Float = 1.5
+  
+  /// Optional. The largest number of replicas simulated at the same time.
+  ///
+  /// The default value is `nil`, which simulates one replica per active
+  /// processor core. On the CPU platform, each OpenMM context starts its own
+  /// threads. Set `forceField.threadCount` so this value times the thread
+  /// count does not exceed the number of cores.
+  public var maximumConcurrency: Int?
+  
+  /// Required. The number of replicas.
+  ///
+  /// The default value is 1.
+  public var replicaCount: Int = 1
+  
+  /// Required. The seed for the thermal velocities.
+  ///
+  /// The default value is 0. Each replica draws from a generator seeded with
+  /// this value and the replica's index, so every replica has different
+  /// velocities and the ensemble is reproducible.
+  public var seed: UInt64 = 0
+  
+  /// Optional. The temperature (in kelvin) to initialize each replica at.
+  ///
+  /// The default value is `nil`, which keeps the velocities of the rigid
+  /// bodies. When specified, `forceField.rigidBodies` must be set.
+  public var temperature: Float?
+  
+  public init() {
+    
+  }
+}
+
+/// Many replicas of the same system, simulated in parallel.
+///
+/// Gathering statistics often requires dozens of thermal replicas of the same
+/// mechanism. The ensemble creates one force field per replica, all sharing
+/// the same parameters, and distributes the replicas over a fixed number of
+/// threads.
+public class MM4Ensemble {
+  /// The force field of each replica.
+  public let replicas: [MM4ForceField]
+  
+  /// The largest number of replicas simulated at the same time.
+  public let maximumConcurrency: Int
+  
+  /// Create an ensemble using the specified configuration.
+  public init(descriptor: MM4EnsembleDescriptor) {
+    guard descriptor.replicaCount > 0 else {
+      fatalError("Ensemble must have at least one replica.")
+    }
+    if let maximumConcurrency = descriptor.maximumConcurrency {
+      guard maximumConcurrency > 0 else {
+        fatalError("Maximum concurrency must be positive.")
+      }
+    }
+    if descriptor.temperature != nil,
+       descriptor.forceField.rigidBodies == nil {
+      fatalError("Thermalizing an ensemble requires rigid bodies.")
+    }
+    let processorCount = ProcessInfo.processInfo.activeProcessorCount
+    let concurrency = min(
+      descriptor.maximumConcurrency ?? processorCount,
+      descriptor.replicaCount)
+    maximumConcurrency = concurrency
+    
+    // Combine the parameters once, so every replica references the same
+    // arrays.
+    let parameters = MM4ForceField.createParameters(
+      descriptor: descriptor.forceField)
+    let replicaCount = descriptor.replicaCount
+    
+    // Rigid bodies cache derived properties the first time they are read, so
+    // reading the same rigid body from several threads is a data race. Clone
+    // the rigid bodies for each replica on this thread.
+    var replicaDescriptors: [MM4ForceFieldDescriptor] = []
+    replicaDescriptors.reserveCapacity(replicaCount)
+    for _ in 0..<replicaCount {
+      var replicaDescriptor = descriptor.forceField
+      replicaDescriptor.rigidBodies = descriptor.forceField.rigidBodies?.map {
+        var rigidBody = $0
+        rigidBody.ensureUniquelyReferenced()
+        return rigidBody
+      }
+      replicaDescriptors.append(replicaDescriptor)
+    }
+    
+    replicas = Array(unsafeUninitializedCapacity: replicaCount) {
+      let baseAddress = $0.baseAddress.unsafelyUnwrapped
+      MM4Ensemble.forEach(
+        count: replicaCount, concurrency: concurrency
+      ) { replicaID in
+        var replicaDescriptor = replicaDescriptors[replicaID]
+        if let temperature = descriptor.temperature {
+          var generator = MM4SplitMixGenerator(
+            seed: descriptor.seed, stream: UInt64(replicaID))
+          for rigidBodyID in replicaDescriptor.rigidBodies!.indices {
+            replicaDescriptor.rigidBodies![rigidBodyID].setThermalKineticEnergy(
+              temperature: temperature,
+              heatCapacity: descriptor.heatCapacity,
+              using: &generator)
+          }
+        }
+        let forceField = MM4ForceField(
+          descriptor: replicaDescriptor, parameters: parameters)
+        baseAddress.advanced(by: replicaID).initialize(to: forceField)
+      }
+      $1 = replicaCount
+    }
+  }
+  
+  /// Simulate every replica's evolution for the specified time interval.
+  ///
+  /// - Parameter time: The time interval, in picoseconds.
+  public func simulate(time: Double) {
+    MM4Ensemble.forEach(
+      count: replicas.count, concurrency: maximumConcurrency
+    ) { replicaID in
+      replicas[replicaID].simulate(time: time)
+    }
+  }
+  
+  /// Retrieve a frame of every replica, fetching them in parallel.
+  public func states(descriptor: MM4StateDescriptor) -> [MM4State] {
+    let replicaCount = replicas.count
+    return Array(unsafeUninitializedCapacity: replicaCount) {
+      let baseAddress = $0.baseAddress.unsafelyUnwrapped
+      MM4Ensemble.forEach(
+        count: replicaCount, concurrency: maximumConcurrency
+      ) { replicaID in
+        let state = replicas[replicaID].state(descriptor: descriptor)
+        baseAddress.advanced(by: replicaID).initialize(to: state)
+      }
+      $1 = replicaCount
+    }
+  }
+  
+  /// Run the closure once per replica, with at most `concurrency` replicas
+  /// at the same time. Each thread handles a strided subset of the replicas.
+  static func forEach(
+    count: Int, concurrency: Int, _ closure: (Int) -> Void
+  ) {
+    let threadCount = min(count, concurrency)
+    DispatchQueue.concurrentPerform(iterations: threadCount) { threadID in
+      for replicaID in stride(from: threadID, to: count, by: threadCount) {
+        closure(replicaID)
+      }
+    }
+  }
+}
+
+/// A seeded generator, so the velocities of each replica are reproducible.
+///
+/// Reference: Steele et al., Fast splittable pseudorandom number generators
+/// (2014)
+struct MM4SplitMixGenerator: RandomNumberGenerator {
+  var state: UInt64
+  
+  init(seed: UInt64, stream: UInt64) {
+    state = seed ^ (stream &* 0xD1B5_4A32_D192_ED03)
+  }
+  
+  mutating func next() -> UInt64 {
+    state &+= 0x9E37_79B9_7F4A_7C15
+    var z = state
+    z = (z ^ (z >> 30)) &* 0xBF58_476D_1CE4_E5B9
+    z = (z ^ (z >> 27)) &* 0x94D0_49BB_1331_11EB
+    return z ^ (z >> 31)
+  }
+}
@@ -0,0 +1,166 @@
+//
+//  MM4ForceField+Batch.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+/// A configuration for minimizing many independent structures together.
+public struct MM4BatchMinimizationDescriptor {
+  /// Required. The configuration of the shared force field.
+  ///
+  /// The default value is the default force field descriptor. `parameters`,
+  /// `rigidBodies`, and `boxVectors` must not be set.
+  public var forceField: MM4ForceFieldDescriptor = MM4ForceFieldDescriptor()
+  
+  /// Required. The configuration of the minimization.
+  ///
+  /// The default value is the default minimization descriptor. The progress
+  /// handler receives the largest force over the entire batch.
+  public var minimization: MM4MinimizationDescriptor =
+  MM4MinimizationDescriptor()
+  
+  /// Required. The parameters of each structure.
+  ///
+  /// The default value is an empty array.
+  public var parameters: [MM4Parameters] = []
+  
+  /// Required. The position (in nanometers) of each atom, grouped by
+  /// structure.
+  ///
+  /// The default value is an empty array. The array must have one element
+  /// per structure, with one position per atom.
+  public var positions: [[SIMD3<Float>]] = []
+  
+  public init() {
+    
+  }
+}
+
+/// The outcome of minimizing many independent structures together.
+public struct MM4BatchMinimizationResult {
+  /// Whether the largest force on each structure fell below the tolerance.
+  public var converged: [Bool]
+  
+  /// The largest force (in piconewtons) on a movable atom of each structure.
+  public var maximumForces: [Double]
+  
+  /// The minimized position (in nanometers) of each atom, grouped by
+  /// structure.
+  public var positions: [[SIMD3<Float>]]
+  
+  /// The state of the entire batch after the last iteration.
+  public var progress: MM4MinimizationProgress
+}
+
+extension MM4ForceField {
+  /// Minimize many independent structures with one OpenMM context.
+  ///
+  /// Creating a force field costs far more than minimizing a small molecule.
+  /// This function packs the structures into one system, so the setup cost is
+  /// paid once. The structures are placed on a grid, with more than the
+  /// cutoff distance between them, so they never interact. The minimization
+  /// continues until every structure has converged. Afterward, each
+  /// structure is moved back to where it started.
+  public static func minimize(
+    batch descriptor: MM4BatchMinimizationDescriptor
+  ) -> MM4BatchMinimizationResult {
+    guard descriptor.parameters.count == descriptor.positions.count,
+          descriptor.parameters.count > 0 else {
+      fatalError("Batch must have one set of positions per structure.")
+    }
+    guard descriptor.forceField.parameters == nil,
+          descriptor.forceField.rigidBodies == nil,
+          descriptor.forceField.boxVectors == nil else {
+      fatalError("Batch force field cannot specify structures or a cell.")
+    }
+    
+    // Find the bounds of each structure, and the atoms where it begins.
+    var atomOffsets: [Int] = []
+    var minimums: [SIMD3<Float>] = []
+    var largestExtent = SIMD3<Float>.zero
+    var atomCount: Int = 0
+    for (parameters, positions) in zip(
+      descriptor.parameters, descriptor.positions) {
+      guard parameters.atoms.count == positions.count else {
+        fatalError("Position count does not match atom count.")
+      }
+      var minimum = positions.first ?? .zero
+      var maximum = positions.first ?? .zero
+      for position in positions {
+        minimum.replace(with: position, where: position .< minimum)
+        maximum.replace(with: position, where: position .> maximum)
+      }
+      atomOffsets.append(atomCount)
+      minimums.append(minimum)
+      largestExtent = pointwiseMax(largestExtent, maximum - minimum)
+      atomCount += positions.count
+    }
+    atomOffsets.append(atomCount)
+    
+    // Atoms move a fraction of a nanometer during minimization, so 1 nm of
+    // padding keeps the structures out of each other's cutoff.
+    let cutoff = descriptor.forceField.cutoffDistance
+    let spacing = largestExtent + cutoff + 1
+    let structureCount = descriptor.parameters.count
+    var gridWidth = 1
+    while gridWidth * gridWidth * gridWidth < structureCount {
+      gridWidth += 1
+    }
+    let translations = (0..<structureCount).map { structureID in
+      let cell = SIMD3(
+        structureID % gridWidth,
+        structureID / gridWidth % gridWidth,
+        structureID / (gridWidth * gridWidth))
+      return SIMD3<Float>(cell) * spacing - minimums[structureID]
+    }
+    
+    var forceFieldDescriptor = descriptor.forceField
+    forceFieldDescriptor.parameters = MM4Parameters(
+      concatenating: descriptor.parameters)
+    let forceField = MM4ForceField(descriptor: forceFieldDescriptor)
+    forceField.positions = Array(unsafeUninitializedCapacity: atomCount) {
+      let baseAddress = $0.baseAddress.unsafelyUnwrapped
+      for structureID in 0..<structureCount {
+        let positions = descriptor.positions[structureID]
+        let translation = translations[structureID]
+        let target = baseAddress.advanced(by: atomOffsets[structureID])
+        for atomID in positions.indices {
+          target.advanced(by: atomID)
+            .initialize(to: positions[atomID] + translation)
+        }
+      }
+      $1 = atomCount
+    }
+    let minimization = forceField.minimize(
+      descriptor: descriptor.minimization)
+    
+    // Unpack the positions and check each structure for convergence.
+    let positions = forceField.positions
+    let forces = forceField.forces
+    let masses = forceField.system.parameters.atoms.masses
+    var converged: [Bool] = []
+    var maximumForces: [Double] = []
+    var unpackedPositions: [[SIMD3<Float>]] = []
+    for structureID in 0..<structureCount {
+      let range = atomOffsets[structureID]..<atomOffsets[structureID + 1]
+      let translation = translations[structureID]
+      var maximumForce: Float = 0
+      for atomID in range where masses[atomID] > 0 {
+        let force = forces[atomID]
+        maximumForce = max(maximumForce, (force * force).sum())
+      }
+      maximumForce = maximumForce.squareRoot()
+      
+      converged.append(
+        Double(maximumForce) < descriptor.minimization.forceTolerance)
+      maximumForces.append(Double(maximumForce))
+      unpackedPositions.append(positions[range].map { $0 - translation })
+    }
+    return MM4BatchMinimizationResult(
+      converged: converged,
+      maximumForces: maximumForces,
+      positions: unpackedPositions,
+      progress: minimization.progress)
+  }
+}
@@ -63,6 +63,10 @@ extension MM4ForceField {
   /// version of BFGS, an O(n^2) algorithm. BFGS improves upon O(n^3) methods
   /// such as Newton's method.
   ///
+  /// OpenMM cannot report progress to MM4. To observe the minimization, stop
+  /// it early, or converge on the largest force, use
+  /// <doc:MM4ForceField/minimize(descriptor:)>.
+  ///
   /// - Parameter tolerance: Accepted uncertainty in potential energy,
   ///   in zeptojoules. The default value is 10. This contrasts with the default
   ///   value for most OpenMM simulations, which is 16.6 zJ (10.0 kJ/mol).
@@ -0,0 +1,433 @@
+//
+//  MM4ForceField+Minimize.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import OpenMM
+
+/// An algorithm for energy minimization.
+public enum MM4MinimizationAlgorithm {
+  /// The fast inertial relaxation engine.
+  ///
+  /// FIRE runs damped molecular dynamics, steering each velocity toward the
+  /// force. It is robust for structures far from equilibrium, such as newly
+  /// compiled geometry with overlapping atoms.
+  case fire
+  
+  /// Limited-memory BFGS with a backtracking line search.
+  ///
+  /// L-BFGS needs fewer force evaluations than FIRE close to a minimum.
+  case lbfgs
+}
+
+/// A configuration for an energy minimization.
+public struct MM4MinimizationDescriptor {
+  /// Required. The algorithm for gradient descent.
+  ///
+  /// The default value is `.lbfgs`.
+  public var algorithm: MM4MinimizationAlgorithm = .lbfgs
+  
+  /// Required. The largest force (in piconewtons) on any movable atom, when
+  /// the minimization has converged.
+  ///
+  /// The default value is 10 pN.
+  public var forceTolerance: Double = 10
+  
+  /// Required. The maximum number of iterations.
+  ///
+  /// The default value is 1000. An L-BFGS iteration may evaluate the forces
+  /// several times during its line search.
+  public var maxIterations: Int = 1000
+  
+  /// Optional. A closure called after each iteration.
+  ///
+  /// The default value is `nil`. Return `false` to stop the minimization.
+  /// The positions from the most recent iteration are kept.
+  public var progressHandler: ((MM4MinimizationProgress) -> Bool)?
+  
+  public init() {
+    
+  }
+}
+
+/// The state of an energy minimization after one iteration.
+public struct MM4MinimizationProgress {
+  /// The number of completed iterations.
+  public var iteration: Int
+  
+  /// The largest force (in piconewtons) on any movable atom.
+  public var maximumForce: Double
+  
+  /// The system's total potential energy, in zeptojoules.
+  public var potentialEnergy: Double
+}
+
+/// The outcome of an energy minimization.
+public struct MM4MinimizationResult {
+  /// Whether the largest force fell below the tolerance.
+  public var converged: Bool
+  
+  /// The state after the last iteration.
+  public var progress: MM4MinimizationProgress
+}
+
+extension MM4ForceField {
+  /// Minimize the system's potential energy, reporting progress after every
+  /// iteration.
+  ///
+  /// Unlike <doc:MM4ForceField/minimize(tolerance:maxIterations:)>, the
+  /// minimizer runs in MM4. It evaluates forces through the existing OpenMM
+  /// context, and converges when the largest force falls below a tolerance.
+  /// Anchors do not move. Velocities are not changed.
+  @discardableResult
+  public func minimize(
+    descriptor: MM4MinimizationDescriptor
+  ) -> MM4MinimizationResult {
+    guard descriptor.forceTolerance > 0,
+          descriptor.maxIterations > 0 else {
+      fatalError("Minimization descriptor was invalid.")
+    }
+    if updateRecord.active() {
+      flushUpdateRecord()
+    }
+    invalidatePositionsAndVelocities()
+    invalidateForcesAndEnergy()
+    
+    // Switch to an integrator that always reports the correct velocity.
+    var integratorDescriptor = MM4IntegratorDescriptor()
+    integratorDescriptor.start = true
+    integratorDescriptor.end = true
+    context.currentIntegrator = integratorDescriptor
+    
+    var minimizer = MM4Minimizer(forceField: self)
+    switch descriptor.algorithm {
+    case .fire:
+      let innerStep = timeStep / Double(context.innerStepCount)
+      return minimizer.minimizeFIRE(
+        descriptor: descriptor, maximumTimeStep: innerStep)
+    case .lbfgs:
+      return minimizer.minimizeLBFGS(descriptor: descriptor)
+    }
+  }
+}
+
+/// Evaluates the potential energy surface through an OpenMM context.
+///
+/// Positions and forces are kept in double precision and in the original
+/// order, so the minimizer never rounds the coordinates it has not moved.
+struct MM4Minimizer {
+  var context: MM4Context
+  var system: MM4System
+  
+  /// Whether each atom is held in place.
+  var frozenMask: [Bool]
+  
+  /// The current position of each atom.
+  var positions: [SIMD3<Double>]
+  
+  /// The current force on each atom, zero for frozen atoms.
+  var forces: [SIMD3<Double>] = []
+  
+  /// The current potential energy.
+  var potentialEnergy: Double = 0
+  
+  init(forceField: MM4ForceField) {
+    self.context = forceField.context
+    self.system = forceField.system
+    
+    frozenMask = system.parameters.atoms.masses.map { $0 == 0 }
+    
+    let query = context.context.state(types: [.positions])
+    positions = system.reorderedIndices.map { reordered in
+      query.positions[Int(reordered)]
+    }
+    (potentialEnergy, forces) = evaluate(positions)
+  }
+  
+  /// Place the atoms at the specified positions, then compute the energy
+  /// and forces.
+  func evaluate(
+    _ positions: [SIMD3<Double>]
+  ) -> (potentialEnergy: Double, forces: [SIMD3<Double>]) {
+    let array = context.positionsBuffer
+    MM4Context.withTransferTasks(count: positions.count) { range in
+      for atomID in range {
+        let reordered = Int(system.reorderedIndices[atomID])
+        array[reordered] = positions[atomID]
+      }
+    }
+    for virtualSiteID in 0..<system.virtualSiteCount {
+      let parents = system.virtualSiteParents[virtualSiteID]
+      let weight = Double(system.virtualSiteWeights[virtualSiteID])
+      let other = positions[Int(parents[0])]
+      let hydrogen = positions[Int(parents[1])]
+      let reordered = system.virtualSiteReorder(Int(parents[1]))
+      array[reordered] = other + weight * (hydrogen - other)
+    }
+    context.context.positions = array
+    
+    // OpenMM distributes the forces on virtual sites to their parents.
+    let query = context.context.state(types: [.energy, .forces])
+    let input = query.forces
+    var forces = [SIMD3<Double>](repeating: .zero, count: positions.count)
+    forces.withUnsafeMutableBufferPointer {
+      let baseAddress = $0.baseAddress.unsafelyUnwrapped
+      MM4Context.withTransferTasks(count: positions.count) { range in
+        for atomID in range where !frozenMask[atomID] {
+          let reordered = Int(system.reorderedIndices[atomID])
+          baseAddress[atomID] = input[reordered]
+        }
+      }
+    }
+    return (query.potentialEnergy, forces)
+  }
+  
+  /// Accept a trial point, then report it to the progress handler.
+  ///
+  /// Returns whether the minimization should continue.
+  mutating func accept(
+    _ positions: [SIMD3<Double>],
+    _ evaluation: (potentialEnergy: Double, forces: [SIMD3<Double>]),
+    iteration: Int,
+    descriptor: MM4MinimizationDescriptor
+  ) -> Bool {
+    self.positions = positions
+    (potentialEnergy, forces) = evaluation
+    if let progressHandler = descriptor.progressHandler {
+      return progressHandler(progress(iteration: iteration))
+    }
+    return true
+  }
+  
+  func progress(iteration: Int) -> MM4MinimizationProgress {
+    var maximumForce: Double = 0
+    for force in forces {
+      maximumForce = max(maximumForce, (force * force).sum())
+    }
+    return MM4MinimizationProgress(
+      iteration: iteration,
+      maximumForce: maximumForce.squareRoot(),
+      potentialEnergy: potentialEnergy)
+  }
+  
+  func result(iteration: Int, tolerance: Double) -> MM4MinimizationResult {
+    let progress = progress(iteration: iteration)
+    return MM4MinimizationResult(
+      converged: progress.maximumForce < tolerance,
+      progress: progress)
+  }
+}
+
+extension MM4Minimizer {
+  /// The largest distance (in nanometers) an atom may move in one iteration.
+  static let maximumDisplacement: Double = 0.01
+  
+  @inline(__always)
+  static func dot(_ lhs: [SIMD3<Double>], _ rhs: [SIMD3<Double>]) -> Double {
+    var sum: Double = 0
+    for i in lhs.indices {
+      sum += (lhs[i] * rhs[i]).sum()
+    }
+    return sum
+  }
+  
+  /// Shrink the displacement so no atom moves farther than the limit.
+  @inline(__always)
+  static func clamp(_ displacements: inout [SIMD3<Double>]) {
+    var maximum: Double = 0
+    for displacement in displacements {
+      maximum = max(maximum, (displacement * displacement).sum())
+    }
+    maximum = maximum.squareRoot()
+    if maximum > maximumDisplacement {
+      let scale = maximumDisplacement / maximum
+      for i in displacements.indices {
+        displacements[i] *= scale
+      }
+    }
+  }
+  
+  /// Reference: Bitzek et al., Structural relaxation made simple (2006)
+  mutating func minimizeFIRE(
+    descriptor: MM4MinimizationDescriptor,
+    maximumTimeStep: Double
+  ) -> MM4MinimizationResult {
+    let tolerance = descriptor.forceTolerance
+    let inverseMasses = system.parameters.atoms.masses.map {
+      ($0 == 0) ? 0 : 1 / Double($0)
+    }
+    var velocities = [SIMD3<Double>](repeating: .zero, count: positions.count)
+    var timeStep = maximumTimeStep / 4
+    var alpha: Double = 0.1
+    var downhillCount: Int = 0
+    
+    var iteration = 0
+    while iteration < descriptor.maxIterations,
+          progress(iteration: iteration).maximumForce >= tolerance {
+      // Steer the velocities toward the forces while moving downhill.
+      let power = Self.dot(forces, velocities)
+      if power > 0 {
+        let velocityNorm = Self.dot(velocities, velocities).squareRoot()
+        let forceNorm = Self.dot(forces, forces).squareRoot()
+        let forceScale = max(forceNorm, .leastNonzeroMagnitude)
+        let mixing = alpha * velocityNorm / forceScale
+        for i in velocities.indices {
+          velocities[i] = (1 - alpha) * velocities[i] + mixing * forces[i]
+        }
+        downhillCount += 1
+        if downhillCount > 5 {
+          timeStep = min(timeStep * 1.1, maximumTimeStep)
+          alpha *= 0.99
+        }
+      } else {
+        for i in velocities.indices {
+          velocities[i] = .zero
+        }
+        timeStep *= 0.5
+        alpha = 0.1
+        downhillCount = 0
+      }
+      
+      // Semi-implicit Euler step.
+      var displacements = [SIMD3<Double>](
+        repeating: .zero, count: velocities.count)
+      for i in velocities.indices {
+        velocities[i] += timeStep * inverseMasses[i] * forces[i]
+        displacements[i] = timeStep * velocities[i]
+      }
+      Self.clamp(&displacements)
+      var trialPositions = positions
+      for i in trialPositions.indices {
+        trialPositions[i] += displacements[i]
+      }
+      
+      iteration += 1
+      let evaluation = evaluate(trialPositions)
+      guard accept(
+        trialPositions, evaluation,
+        iteration: iteration, descriptor: descriptor) else {
+        break
+      }
+    }
+    return result(iteration: iteration, tolerance: tolerance)
+  }
+  
+  /// Reference: Nocedal, Updating quasi-Newton matrices with limited
+  /// storage (1980)
+  mutating func minimizeLBFGS(
+    descriptor: MM4MinimizationDescriptor
+  ) -> MM4MinimizationResult {
+    let tolerance = descriptor.forceTolerance
+    let memoryCount = 10
+    var positionChanges: [[SIMD3<Double>]] = []
+    var forceChanges: [[SIMD3<Double>]] = []
+    
+    var iteration = 0
+    while iteration < descriptor.maxIterations,
+          progress(iteration: iteration).maximumForce >= tolerance {
+      // Two-loop recursion. The forces are the negative gradient, so the
+      // result is the search direction.
+      var direction = forces
+      var coefficients: [Double] = []
+      for i in positionChanges.indices.reversed() {
+        let s = positionChanges[i]
+        let y = forceChanges[i]
+        let coefficient = Self.dot(s, direction) / Self.dot(y, s)
+        coefficients.append(coefficient)
+        for j in direction.indices {
+          direction[j] -= coefficient * y[j]
+        }
+      }
+      if let s = positionChanges.last, let y = forceChanges.last {
+        let gamma = Self.dot(s, y) / Self.dot(y, y)
+        for j in direction.indices {
+          direction[j] *= gamma
+        }
+      } else {
+        // Without curvature information, the first step moves the most
+        // strained atom by the maximum displacement.
+        let forceNorm = progress(iteration: iteration).maximumForce
+        let scale = Self.maximumDisplacement / forceNorm
+        for j in direction.indices {
+          direction[j] *= scale
+        }
+      }
+      for i in positionChanges.indices {
+        let s = positionChanges[i]
+        let y = forceChanges[i]
+        let coefficient = coefficients[positionChanges.count - 1 - i]
+        let beta = Self.dot(y, direction) / Self.dot(y, s)
+        for j in direction.indices {
+          direction[j] += (coefficient - beta) * s[j]
+        }
+      }
+      
+      // Fall back to steepest descent if the direction points uphill.
+      var slope = Self.dot(forces, direction)
+      if !(slope > 0) {
+        positionChanges = []
+        forceChanges = []
+        direction = forces
+        slope = Self.dot(forces, direction)
+      }
+      Self.clamp(&direction)
+      slope = Self.dot(forces, direction)
+      
+      // Backtrack until the energy decreases sufficiently.
+      var stepSize: Double = 1
+      var accepted: (
+        positions: [SIMD3<Double>],
+        evaluation: (potentialEnergy: Double, forces: [SIMD3<Double>])
+      )?
+      for _ in 0..<20 {
+        var trialPositions = positions
+        for j in trialPositions.indices {
+          trialPositions[j] += stepSize * direction[j]
+        }
+        let evaluation = evaluate(trialPositions)
+        if evaluation.potentialEnergy <=
+            potentialEnergy - 1e-4 * stepSize * slope {
+          accepted = (trialPositions, evaluation)
+          break
+        }
+        stepSize *= 0.5
+      }
+      guard let accepted else {
+        // Restore the last accepted positions in the context.
+        _ = evaluate(positions)
+        if positionChanges.isEmpty {
+          break
+        }
+        positionChanges = []
+        forceChanges = []
+        continue
+      }
+      
+      // Store the curvature pair, using the change in gradient.
+      var s = accepted.positions
+      var y = forces
+      for j in s.indices {
+        s[j] -= positions[j]
+        y[j] -= accepted.evaluation.forces[j]
+      }
+      if Self.dot(s, y) > 1e-12 {
+        positionChanges.append(s)
+        forceChanges.append(y)
+        if positionChanges.count > memoryCount {
+          positionChanges.removeFirst()
+          forceChanges.removeFirst()
+        }
+      }
+      
+      iteration += 1
+      guard accept(
+        accepted.positions, accepted.evaluation,
+        iteration: iteration, descriptor: descriptor) else {
+        break
+      }
+    }
+    return result(iteration: iteration, tolerance: tolerance)
+  }
+}
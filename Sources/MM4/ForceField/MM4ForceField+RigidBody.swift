@@ -6,51 +6,25 @@
 //
 
 extension MM4ForceField {
-  static func createParameters(rigidBodies: [MM4RigidBody]) -> MM4Parameters {
-    // Avoid a costly O(nlogn) series of reallocations while combining each
-    // rigid body's parameters.
-    var atomCapacity: Int = 0
-    var bondCapacity: Int = 0
-    var angleCapacity: Int = 0
-    var torsionCapacity: Int = 0
-    var ringCapacity: Int = 0
-    var exception13Capacity: Int = 0
-    var exception14Capacity: Int = 0
-    
-    var ranges: [Range<Int>] = []
-    for rigidBody in rigidBodies {
-      let oldAtomCapacity = atomCapacity
-      
-      let parameters = rigidBody.parameters
-      atomCapacity += parameters.atoms.count
-      bondCapacity += parameters.bonds.indices.count
-      angleCapacity += parameters.angles.indices.count
-      torsionCapacity += parameters.torsions.indices.count
-      ringCapacity += parameters.rings.indices.count
-      exception13Capacity += parameters.nonbondedExceptions13.count
-      exception14Capacity += parameters.nonbondedExceptions14.count
-      
-      ranges.append(oldAtomCapacity..<atomCapacity)
-    }
-    
-    // Gracefully handle the case where there are zero rigid bodies.
-    var descriptor = MM4ParametersDescriptor()
-    descriptor.atomicNumbers = []
-    descriptor.bonds = []
-    var parameters = try! MM4Parameters(descriptor: descriptor)
-    parameters.atoms.reserveCapacity(atomCapacity)
-    parameters.bonds.reserveCapacity(bondCapacity)
-    parameters.angles.reserveCapacity(angleCapacity)
-    parameters.torsions.reserveCapacity(torsionCapacity)
-    parameters.rings.reserveCapacity(ringCapacity)
-    parameters.nonbondedExceptions13.reserveCapacity(exception13Capacity)
-    parameters.nonbondedExceptions14.reserveCapacity(exception14Capacity)
-    parameters.atomsToBondsMap.reserveCapacity(bondCapacity)
-    parameters.atomsToAtomsMap.reserveCapacity(atomCapacity)
-    for rigidBody in rigidBodies {
-      parameters.append(contentsOf: rigidBody.parameters)
+  static func createParameters(
+    descriptor: MM4ForceFieldDescriptor
+  ) -> MM4Parameters {
+    switch (descriptor.parameters, descriptor.rigidBodies) {
+    case (.some(let parameters), nil):
+      return parameters
+    case (nil, .some(let rigidBodies)):
+      return createParameters(rigidBodies: rigidBodies)
+    case (nil, nil):
+      fatalError("Did not specify parameters or rigid bodies.")
+    case (.some(_), .some(_)):
+      fatalError("Specified both parameters and rigid bodies.")
     }
-    return parameters
+  }
+  
+  static func createParameters(rigidBodies: [MM4RigidBody]) -> MM4Parameters {
+    // Avoid a costly series of reallocations and dictionary insertions while
+    // combining each rigid body's parameters.
+    MM4Parameters(concatenating: rigidBodies.map(\.parameters))
   }
   
   /// Write the force field's internal state to the specified rigid body.
@@ -64,7 +38,7 @@ extension MM4ForceField {
     }
     ensurePositionsAndVelocitiesCached()
     guard range.startIndex >= 0,
-          range.endIndex < system.parameters.atoms.count,
+          range.endIndex <= system.parameters.atoms.count,
           range.count == rigidBody.parameters.atoms.count else {
       fatalError("Atom range was invalid.")
     }
@@ -91,13 +65,13 @@ extension MM4ForceField {
     updateRecord.positions = true
     updateRecord.velocities = true
     guard range.startIndex >= 0,
-          range.endIndex < system.parameters.atoms.count,
+          range.endIndex <= system.parameters.atoms.count,
           range.count == rigidBody.parameters.atoms.count else {
       fatalError("Atom range was invalid.")
     }
     
     // Change the force field's external forces, positions, and velocities.
-    _externalForces.replaceSubrange(range, with: externalForces)
+    _externalForces.replaceSubrange(range, with: rigidBody.externalForces)
     cachedState.positions!.replaceSubrange(range, with: rigidBody.positions)
     cachedState.velocities!.replaceSubrange(range, with: rigidBody.velocities)
   }
@@ -22,6 +22,43 @@ extension MM4ForceField {
   }
 }
 
+extension MM4ForceField {
+  /// The largest time step (in picoseconds) that keeps the fastest vibration
+  /// within the specified energy fluctuation.
+  ///
+  /// Velocity Verlet conserves a shadow energy for each harmonic mode. For a
+  /// mode with angular frequency `ω`, the true energy fluctuates by a
+  /// fraction `x / (1 - x)` of itself, where `x = (ωh)^2 / 4` and `h` is the
+  /// step for the forces acting on that mode. Stretch and bend forces use the
+  /// inner step, so the outer step is `innerStepCount` times larger. The
+  /// outer step never exceeds 90% of the half period of the fastest
+  /// vibration, where r-RESPA becomes unstable from resonance.
+  ///
+  /// The frequencies are estimated by
+  /// <doc:MM4Parameters/maximumVibrationalFrequency()>, so the result grows
+  /// with `hydrogenMassScale`. To use it, assign the result to `timeStep`.
+  ///
+  /// - Parameter energyDrift: The accepted fluctuation in the energy of the
+  ///   fastest vibration, as a fraction of that energy. The default value,
+  ///   0.25, keeps the inner step near 0.9 / ω. With the default hydrogen mass
+  ///   scale, this is close to the default time step.
+  public func maximumTimeStep(energyDrift: Double = 0.25) -> Double {
+    guard energyDrift > 0 else {
+      fatalError("Energy drift must be positive.")
+    }
+    let omega = system.parameters.maximumVibrationalFrequency()
+    guard omega > 0 else {
+      return _timeStep
+    }
+    
+    let x = energyDrift / (1 + energyDrift)
+    let innerStep = 2 * x.squareRoot() / omega
+    let outerStep = innerStep * Double(context.innerStepCount)
+    let resonanceLimit = 0.9 * Double.pi / omega
+    return min(outerStep, resonanceLimit)
+  }
+}
+
 extension MM4ForceField {
   /// Simulate the system's evolution for the specified time interval.
   ///
@@ -45,6 +82,11 @@ extension MM4ForceField {
       fatalError("Time or time step was invalid.")
     }
     
+    if let controller = timeStepController {
+      simulateAdaptive(time: time, controller: controller)
+      return
+    }
+    
     // Create rough estimate of step count.
     var quotient = (time / timeStep).rounded(.down)
     var remainder = (time / timeStep) - quotient
@@ -70,6 +112,9 @@ extension MM4ForceField {
       descriptor.end = true
       context.currentIntegrator = descriptor
       context.step(1, timeStep: time)
+      
+      _simulationStatistics = MM4SimulationStatistics()
+      _simulationStatistics.record(stepCount: 1, timeStep: time)
     } else {
       var descriptor = MM4IntegratorDescriptor()
       descriptor.start = true
@@ -87,7 +132,13 @@ extension MM4ForceField {
       descriptor.start = false
       descriptor.end = true
       context.currentIntegrator = descriptor
-      context.step(1, timeStep: remainder)
+      context.step(1, timeStep: remainder * timeStep)
+      
+      _simulationStatistics = MM4SimulationStatistics()
+      _simulationStatistics.record(
+        stepCount: Int(quotient), timeStep: timeStep)
+      _simulationStatistics.record(
+        stepCount: 1, timeStep: remainder * timeStep)
     }
   }
 }
@@ -0,0 +1,172 @@
+//
+//  MM4ForceField+TimeStepController.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import OpenMM
+
+/// A configuration for adapting the time step during simulation.
+///
+/// The controller integrates in intervals of `sampleInterval` steps. After
+/// each interval, it compares the total energy against the start of the
+/// interval. If the energy changed too much, the interval is rolled back and
+/// repeated with a smaller time step. If the energy barely changed, the next
+/// interval uses a larger time step.
+public struct MM4TimeStepController {
+  /// Required. The largest accepted change in total energy over one
+  /// interval, in zeptojoules per atom.
+  ///
+  /// The default value is 0.1 zJ, about 2.5% of kT at room temperature.
+  public var energyDriftThreshold: Double = 0.1
+  
+  /// Required. The factor to multiply the time step by, after an interval
+  /// with less than a quarter of the threshold.
+  ///
+  /// The default value is 1.1.
+  public var growthFactor: Double = 1.1
+  
+  /// Required. The largest time step, in picoseconds.
+  ///
+  /// The default value is 10 fs.
+  public var maximumTimeStep: Double = 10 * OpenMM_PsPerFs
+  
+  /// Required. The smallest time step, in picoseconds.
+  ///
+  /// The default value is 0.25 fs. Intervals at this time step are accepted,
+  /// even when they exceed the threshold. If the energy is not finite at this
+  /// time step, the simulation has diverged, and a fatal error occurs.
+  public var minimumTimeStep: Double = 0.25 * OpenMM_PsPerFs
+  
+  /// Required. The number of steps between energy samples.
+  ///
+  /// The default value is 50. Each sample transfers the positions and
+  /// velocities from OpenMM, so the rollback state is available.
+  public var sampleInterval: Int = 50
+  
+  /// Required. The factor to multiply the time step by, after a rejected
+  /// interval.
+  ///
+  /// The default value is 0.5.
+  public var shrinkFactor: Double = 0.5
+  
+  public init() {
+    
+  }
+}
+
+/// Statistics about the most recent call to `simulate(time:)`.
+public struct MM4SimulationStatistics {
+  /// The number of steps that were kept.
+  public var stepCount: Int = 0
+  
+  /// The number of steps that were rolled back, because the energy drifted
+  /// past the threshold.
+  public var rejectedStepCount: Int = 0
+  
+  /// The smallest time step that was kept, in picoseconds.
+  public var minimumTimeStep: Double = .infinity
+  
+  /// The largest time step that was kept, in picoseconds.
+  public var maximumTimeStep: Double = 0
+  
+  /// The largest change in total energy over a kept interval, in zeptojoules
+  /// per atom. Zero if the time step controller was not used.
+  public var maximumEnergyDrift: Double = 0
+  
+  mutating func record(stepCount: Int, timeStep: Double) {
+    self.stepCount += stepCount
+    minimumTimeStep = min(minimumTimeStep, timeStep)
+    maximumTimeStep = max(maximumTimeStep, timeStep)
+  }
+}
+
+extension MM4ForceField {
+  /// Optional. Adapts the time step to keep the energy drift under a
+  /// threshold.
+  ///
+  /// The default value is `nil`, which simulates with a fixed time step. When
+  /// specified, the controller starts from `timeStep`, and stores the adapted
+  /// time step back into `timeStep` at the end of every simulation.
+  public var timeStepController: MM4TimeStepController? {
+    _read {
+      yield _timeStepController
+    }
+    _modify {
+      yield &_timeStepController
+    }
+  }
+  
+  /// Statistics about the most recent call to `simulate(time:)`.
+  public var simulationStatistics: MM4SimulationStatistics {
+    _simulationStatistics
+  }
+  
+  /// Simulate with the time step controller.
+  func simulateAdaptive(time: Double, controller: MM4TimeStepController) {
+    guard controller.sampleInterval > 0,
+          controller.minimumTimeStep > 0,
+          controller.minimumTimeStep <= controller.maximumTimeStep,
+          controller.shrinkFactor > 0, controller.shrinkFactor < 1,
+          controller.growthFactor >= 1 else {
+      fatalError("Time step controller was invalid.")
+    }
+    
+    var statistics = MM4SimulationStatistics()
+    let atomCount = Double(max(1, system.parameters.atoms.count))
+    var timeStep = min(
+      max(_timeStep, controller.minimumTimeStep), controller.maximumTimeStep)
+    var remainingTime = time
+    
+    let dataTypes: OpenMM_State.DataType = [.energy, .positions, .velocities]
+    var previousState = context.context.state(types: dataTypes)
+    while remainingTime > 0 {
+      var stepCount = controller.sampleInterval
+      var stepSize = timeStep
+      let finalInterval = Double(stepCount) * stepSize >= remainingTime
+      if finalInterval {
+        stepCount = max(1, Int((remainingTime / stepSize).rounded(.up)))
+        stepSize = remainingTime / Double(stepCount)
+      }
+      context.step(stepCount, timeStep: stepSize, start: true, end: true)
+      
+      let state = context.context.state(types: dataTypes)
+      let previousEnergy =
+        previousState.kineticEnergy + previousState.potentialEnergy
+      let energy = state.kineticEnergy + state.potentialEnergy
+      let drift = abs(energy - previousEnergy) / atomCount
+      
+      if drift > controller.energyDriftThreshold || !energy.isFinite,
+         timeStep > controller.minimumTimeStep {
+        context.context.positions = previousState.positions
+        context.context.velocities = previousState.velocities
+        statistics.rejectedStepCount += stepCount
+        timeStep = max(
+          timeStep * controller.shrinkFactor, controller.minimumTimeStep)
+        continue
+      }
+      guard energy.isFinite else {
+        fatalError("Energy was not finite at the minimum time step.")
+      }
+      
+      statistics.record(stepCount: stepCount, timeStep: stepSize)
+      statistics.maximumEnergyDrift = max(
+        statistics.maximumEnergyDrift, drift)
+      if finalInterval {
+        remainingTime = 0
+      } else {
+        remainingTime -= Double(stepCount) * stepSize
+      }
+      previousState = state
+      
+      if drift < controller.energyDriftThreshold / 4 {
+        timeStep = min(
+          timeStep * controller.growthFactor, controller.maximumTimeStep)
+      }
+    }
+    
+    _timeStep = timeStep
+    _simulationStatistics = statistics
+  }
+}
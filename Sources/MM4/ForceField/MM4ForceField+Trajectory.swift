@@ -0,0 +1,252 @@
+//
+//  MM4ForceField+Trajectory.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import OpenMM
+
+/// A configuration for a trajectory recorder.
+public struct MM4TrajectoryRecorderDescriptor {
+  /// Required. The number of frames held in memory before they are flushed to
+  /// the sink.
+  ///
+  /// The default is 16.
+  public var bufferCapacity: Int = 16
+  
+  /// Required. Whether to report the system's total kinetic and potential
+  /// energy.
+  ///
+  /// The default is `false`.
+  public var energy: Bool = false
+  
+  /// Required. The time between consecutive frames, in picoseconds.
+  ///
+  /// This is rounded to the nearest integer multiple of the force field's time
+  /// step, with a minimum of one step.
+  public var frameInterval: Double?
+  
+  /// Required. Whether to report each atom's position.
+  ///
+  /// The default is `true`.
+  public var positions: Bool = true
+  
+  /// Required. Whether to report each atom's velocity.
+  ///
+  /// The default is `false`.
+  public var velocities: Bool = false
+  
+  public init() {
+    
+  }
+}
+
+/// A frame captured during a trajectory recording.
+///
+/// The arrays are backed by memory owned by the recorder. The sink may keep a
+/// copy of the frame, but the recorder will then allocate new memory for the
+/// next frame written to the same slot.
+public struct MM4TrajectoryFrame {
+  /// The system's total kinetic energy, in zeptojoules.
+  public internal(set) var kineticEnergy: Double?
+  
+  /// The position (in nanometers) of each atom's nucleus.
+  public internal(set) var positions: [SIMD3<Float>]?
+  
+  /// The system's total potential energy, in zeptojoules.
+  public internal(set) var potentialEnergy: Double?
+  
+  /// The time elapsed since the recorder was created, in picoseconds.
+  public internal(set) var time: Double = 0
+  
+  /// The linear velocity (in nanometers per picosecond), of each atom.
+  public internal(set) var velocities: [SIMD3<Float>]?
+}
+
+/// Captures frames at fixed intervals over a long simulation.
+///
+/// Calling `simulate(time:)` repeatedly to sample a trajectory flushes and
+/// invalidates internal state every call, and corrects the velocities at the
+/// start and end of each call. The recorder instead samples frames while
+/// integrating over the entire interval. Positions are exact at every outer
+/// time step, so velocities are only corrected when they (or the kinetic
+/// energy) are requested.
+public class MM4TrajectoryRecorder {
+  var descriptor: MM4TrajectoryRecorderDescriptor
+  var sink: (MM4TrajectoryFrame) -> Void
+  
+  // Frames waiting to be flushed to the sink. Slots are reused after each
+  // flush, so the atom arrays are only allocated once.
+  var frames: [MM4TrajectoryFrame]
+  var frameCount: Int = 0
+  var elapsedTime: Double = 0
+  
+  /// Create a trajectory recorder.
+  ///
+  /// - Parameter descriptor: The configuration of the recorder.
+  /// - Parameter sink: Called on the thread that invoked `simulate`, once for
+  ///   every frame, in chronological order.
+  public init(
+    descriptor: MM4TrajectoryRecorderDescriptor,
+    sink: @escaping (MM4TrajectoryFrame) -> Void
+  ) {
+    guard let frameInterval = descriptor.frameInterval else {
+      fatalError("No frame interval was specified.")
+    }
+    guard frameInterval > 0, descriptor.bufferCapacity > 0 else {
+      fatalError("Frame interval or buffer capacity was invalid.")
+    }
+    self.descriptor = descriptor
+    self.sink = sink
+    self.frames = Array(
+      repeating: MM4TrajectoryFrame(), count: descriptor.bufferCapacity)
+  }
+  
+  /// Send all buffered frames to the sink.
+  ///
+  /// This is called automatically at the end of every recorded simulation.
+  public func flush() {
+    for frameID in 0..<frameCount {
+      sink(frames[frameID])
+    }
+    frameCount = 0
+  }
+}
+
+extension MM4TrajectoryRecorder {
+  /// Whether velocities must be synchronized with positions when capturing a
+  /// frame.
+  var synchronizesVelocities: Bool {
+    descriptor.velocities || descriptor.energy
+  }
+  
+  func stepsPerFrame(timeStep: Double) -> Int {
+    let steps = (descriptor.frameInterval! / timeStep).rounded()
+    return max(1, Int(steps))
+  }
+  
+  func record(context: MM4Context, system: MM4System) {
+    var dataTypes: OpenMM_State.DataType = []
+    if descriptor.energy {
+      dataTypes = [dataTypes, .energy]
+    }
+    if descriptor.positions {
+      dataTypes = [dataTypes, .positions]
+    }
+    if descriptor.velocities {
+      dataTypes = [dataTypes, .velocities]
+    }
+    let query = context.context.state(types: dataTypes)
+    
+    if frameCount == frames.count {
+      flush()
+    }
+    let slot = frameCount
+    frameCount += 1
+    
+    // Detach each array from the frame before writing, so it is uniquely
+    // referenced and overwritten in place.
+    func convertArray(
+      _ input: OpenMM_Vec3Array,
+      _ keyPath: WritableKeyPath<MM4TrajectoryFrame, [SIMD3<Float>]?>
+    ) {
+      var array = frames[slot][keyPath: keyPath] ?? []
+      frames[slot][keyPath: keyPath] = nil
+      MM4Context.convert(input, system: system, into: &array)
+      frames[slot][keyPath: keyPath] = array
+    }
+    
+    frames[slot].time = elapsedTime
+    if descriptor.energy {
+      frames[slot].kineticEnergy = query.kineticEnergy
+      frames[slot].potentialEnergy = query.potentialEnergy
+    }
+    if descriptor.positions {
+      convertArray(query.positions, \.positions)
+    }
+    if descriptor.velocities {
+      convertArray(query.velocities, \.velocities)
+    }
+  }
+}
+
+extension MM4ForceField {
+  /// Simulate the system's evolution for the specified time interval, while
+  /// capturing frames at the recorder's frame interval.
+  ///
+  /// The first frame is captured one frame interval after the start. If the
+  /// time interval is not a multiple of the frame interval, the system is
+  /// simulated for the remaining time without capturing another frame. The
+  /// remaining time is divided into steps no longer than `timeStep`.
+  ///
+  /// Recording does not support a time step controller. The simulation
+  /// statistics are updated the same way as `simulate(time:)`.
+  ///
+  /// - Parameter time: The time interval, in picoseconds.
+  /// - Parameter recorder: The recorder that receives the frames.
+  public func simulate(time: Double, recorder: MM4TrajectoryRecorder) {
+    if updateRecord.active() {
+      flushUpdateRecord()
+    }
+    invalidatePositionsAndVelocities()
+    invalidateForcesAndEnergy()
+    defer {
+      recorder.flush()
+    }
+    
+    if time == 0 {
+      return
+    }
+    guard time > 0, timeStep > 0 else {
+      fatalError("Time or time step was invalid.")
+    }
+    guard timeStepController == nil else {
+      fatalError("Recording does not support a time step controller.")
+    }
+    
+    let stepsPerFrame = recorder.stepsPerFrame(timeStep: timeStep)
+    let frameTime = Double(stepsPerFrame) * timeStep
+    var frameCount = Int((time / frameTime).rounded(.down))
+    var remainder = time - Double(frameCount) * frameTime
+    
+    // Correct for overshoot and undershoot from floating-point error.
+    let epsilon: Double = 1e-4 * timeStep
+    if remainder > frameTime - epsilon {
+      frameCount += 1
+      remainder = 0
+    } else if remainder < epsilon {
+      remainder = 0
+    }
+    
+    // Velocities must be synchronized after the last frame, either to return
+    // control to the user or to change the time step.
+    var synchronized = true
+    for frameID in 0..<frameCount {
+      let end = recorder.synchronizesVelocities || frameID == frameCount - 1
+      context.step(
+        stepsPerFrame, timeStep: timeStep, start: synchronized, end: end)
+      synchronized = end
+      
+      recorder.elapsedTime += frameTime
+      recorder.record(context: context, system: system)
+    }
+    
+    _simulationStatistics = MM4SimulationStatistics()
+    if frameCount > 0 {
+      _simulationStatistics.record(
+        stepCount: frameCount * stepsPerFrame, timeStep: timeStep)
+    }
+    
+    // Split the remainder into equal steps, so none exceeds the time step.
+    if remainder > 0 {
+      let remainderStepCount = Int((remainder / timeStep).rounded(.up))
+      let remainderStep = remainder / Double(remainderStepCount)
+      context.step(
+        remainderStepCount, timeStep: remainderStep, start: true, end: true)
+      recorder.elapsedTime += remainder
+      _simulationStatistics.record(
+        stepCount: remainderStepCount, timeStep: remainderStep)
+    }
+  }
+}
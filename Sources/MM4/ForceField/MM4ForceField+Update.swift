@@ -70,16 +70,8 @@ extension MM4ForceField {
         fatalError("Positions or velocities not fetched before update.")
       }
       
-      let arrayP = OpenMM_Vec3Array(size: system.reorderedIndices.count)
-      let arrayV = OpenMM_Vec3Array(size: system.reorderedIndices.count)
-      for (original, reordered) in system.reorderedIndices.enumerated() {
-        let position = positions[Int(original)]
-        let velocity = velocities[Int(original)]
-        arrayP[Int(reordered)] = SIMD3<Double>(position)
-        arrayV[Int(reordered)] = SIMD3<Double>(velocity)
-      }
-      context.context.positions = arrayP
-      context.context.velocities = arrayV
+      context.setPositionsAndVelocities(
+        positions, velocities, system: system)
     }
     
     if updateRecord.externalForces {
@@ -9,6 +9,19 @@ import OpenMM
 
 /// A configuration for a force field.
 public struct MM4ForceFieldDescriptor {
+  /// Optional. The vectors spanning the periodic cell, in nanometers.
+  ///
+  /// The default value is `nil`, which simulates an isolated structure in
+  /// vacuum. When specified, nonbonded forces use the minimum image
+  /// convention, and bonds may cross the boundaries of the cell.
+  ///
+  /// The vectors must be in OpenMM's reduced form. `a` points along the x-axis,
+  /// `b` lies in the xy-plane, and each vector's component along the previous
+  /// axes is at most half of that axis' length. Every dimension of the cell
+  /// must be at least twice `cutoffDistance`. A bulk crystal only needs a few
+  /// unit cells in each direction, instead of a slab with 10-100x more atoms.
+  public var boxVectors: (a: SIMD3<Float>, b: SIMD3<Float>, c: SIMD3<Float>)?
+  
   /// Required. The cutoff to use for nonbonded interactions.
   ///
   /// The default value is 1.0 nm. This is 2.86σ for carbon and 2.45σ for
@@ -21,6 +34,10 @@ public struct MM4ForceFieldDescriptor {
   /// slightly greater sigma for carbon allows greater accuracy in vdW forces
   /// for bulk diamond. 1.0 nm is also sufficient for charge-charge
   /// interactions.
+  ///
+  /// OpenMM pads the cutoff when building the neighbor list, and decides
+  /// internally when to rebuild it. The padding cannot be configured from
+  /// MM4.
   public var cutoffDistance: Float = 1.0
   
   /// Required. The dielectric constant for the reaction field approximation to
@@ -32,6 +49,34 @@ public struct MM4ForceFieldDescriptor {
   /// is somewhere in the middle, at ~5.
   public var dielectricConstant: Float = 5.7
   
+  /// Required. The number of times cheap bonded forces are evaluated, per
+  /// evaluation of expensive forces.
+  ///
+  /// The default value is 2.
+  ///
+  /// The integrator uses r-RESPA multiple time-stepping. Bend, bend-bend, and
+  /// stretch forces execute at `timeStep / innerStepCount`. Nonbonded,
+  /// electrostatic, torsion, and external forces execute at `timeStep`.
+  /// When nonbonded forces dominate the compute cost, increasing this value
+  /// permits a larger `timeStep` at roughly the same cost per outer step.
+  /// The outer time step is still limited by torsion and nonbonded
+  /// resonances, so values beyond ~4 have diminishing returns.
+  public var innerStepCount: Int = 2
+  
+  /// Required. Whether to omit interactions where every atom is an anchor.
+  ///
+  /// The default value is `false`.
+  ///
+  /// Anchors never move, so interactions among them only produce a constant
+  /// energy and forces on the anchors themselves. When enabled, bonds,
+  /// angles, torsions, and nonbonded exceptions consisting entirely of anchors
+  /// are left out of the system. Charge-charge interactions between two
+  /// anchors are also skipped. The dynamics of other atoms are unchanged, but
+  /// the reported potential energy and the forces on anchors no longer
+  /// include these terms. Structures that are mostly anchors, such as
+  /// housings, become much cheaper to simulate.
+  public var omitsAnchorInteractions: Bool = false
+  
   /// Optional. The parameters to initialize internal forces with.
   ///
   /// This parameter is mutually exclude with `rigidBodies`. You can either
@@ -43,6 +88,21 @@ public struct MM4ForceFieldDescriptor {
   /// Optional. The OpenMM platform to use for simulation.
   public var platform: OpenMM_Platform?
   
+  /// Required. Properties passed to the platform when creating the context.
+  ///
+  /// The default value is an empty dictionary. When not empty, `platform`
+  /// must be set. The valid names and values depend on the platform. For
+  /// example, the CPU platform accepts `"DeterministicForces": "true"`.
+  public var platformProperties: [String: String] = [:]
+  
+  /// Optional. The number of threads the CPU platform may use.
+  ///
+  /// The default value is `nil`, which uses every core. When specified,
+  /// `platform` must be the CPU platform. This overrides the `"Threads"`
+  /// property in `platformProperties`. To pack several simulations onto one
+  /// machine, give each a share of the cores.
+  public var threadCount: Int?
+  
   /// Optional. The rigid bodies to initialize the system with.
   ///
   /// If you do not set the rigid bodies, you must set all positions, velocities,
@@ -78,26 +138,42 @@ public class MM4ForceField {
   /// Stores the time step, in picoseconds.
   var _timeStep: Double = 100 / 23 * OpenMM_PsPerFs
   
+  /// Stores the configuration for adapting the time step.
+  var _timeStepController: MM4TimeStepController?
+  
+  /// Stores statistics about the most recent simulation.
+  var _simulationStatistics = MM4SimulationStatistics()
+  
+  /// The key for returning the force field to the pool that created it.
+  var poolKey: MM4ForceFieldPoolKey?
+  
   /// Create a simulator using the specified configuration.
-  public init(descriptor: MM4ForceFieldDescriptor) {
-    var parameters: MM4Parameters
-    switch (descriptor.parameters, descriptor.rigidBodies) {
-    case (.some(_), nil):
-      parameters = descriptor.parameters!
-    case (nil, .some(let rigidBodies)):
-      parameters = MM4ForceField.createParameters(rigidBodies: rigidBodies)
-    case (nil, nil):
-      fatalError("Did not specify parameters or rigid bodies.")
-    case (.some(_), .some(_)):
-      fatalError("Specified both parameters and rigid bodies.")
+  public convenience init(descriptor: MM4ForceFieldDescriptor) {
+    let parameters = MM4ForceField.createParameters(descriptor: descriptor)
+    self.init(descriptor: descriptor, parameters: parameters)
+  }
+  
+  /// Create a simulator with parameters that were already combined.
+  ///
+  /// Several simulators of the same system can share one copy of the
+  /// parameters.
+  init(descriptor: MM4ForceFieldDescriptor, parameters: MM4Parameters) {
+    if let boxVectors = descriptor.boxVectors {
+      let width = SIMD3(boxVectors.a.x, boxVectors.b.y, boxVectors.c.z)
+      guard boxVectors.a.y == 0, boxVectors.a.z == 0, boxVectors.b.z == 0,
+            all(width .>= 2 * descriptor.cutoffDistance) else {
+        fatalError("Box vectors were not in reduced form or were too small.")
+      }
     }
     
     // Load available plugins before doing anything that might require them.
-    let directory = OpenMM_Platform.defaultPluginsDirectory!
-    _ = OpenMM_Platform.loadPlugins(directory: directory)!
+    MM4ForceField.loadPlugins()
     
-    system = MM4System(parameters: parameters, descriptor: descriptor)
-    context = MM4Context(system: system, platform: descriptor.platform)
+    // Positions from the rigid bodies determine the order of the particles.
+    let positions = descriptor.rigidBodies?.flatMap(\.positions)
+    system = MM4System(
+      parameters: parameters, positions: positions, descriptor: descriptor)
+    context = MM4Context(system: system, descriptor: descriptor)
     cachedState = MM4State()
     updateRecord = MM4UpdateRecord()
     
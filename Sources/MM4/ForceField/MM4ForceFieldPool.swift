@@ -0,0 +1,293 @@
+//
+//  MM4ForceFieldPool.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import Foundation
+import OpenMM
+
+/// A cache of force fields, reused across simulations of the same system.
+///
+/// Creating a force field builds an OpenMM system and compiles several
+/// integrators, which may take seconds for a large part. When the same part
+/// is simulated many times with different initial conditions, the pool hands
+/// out a force field that was created before. The positions, velocities, and
+/// external forces are reset to match the descriptor.
+///
+/// Force fields are matched by their parameters, and by every setting in the
+/// descriptor that changes the OpenMM system. The parameters are looked up by
+/// a hash, then compared in full, so a hash collision never reuses a force
+/// field built for different parameters. The platform
+/// must be the same object, not just the same kind of platform. The pool is
+/// safe to use from multiple threads.
+public class MM4ForceFieldPool {
+  var entries: [MM4ForceFieldPoolKey: [MM4ForceField]] = [:]
+  var lock = NSLock()
+  
+  /// Create an empty pool.
+  public init() {
+    
+  }
+  
+  /// The number of force fields waiting to be reused.
+  public var count: Int {
+    lock.lock()
+    defer { lock.unlock() }
+    return entries.values.reduce(0) { $0 + $1.count }
+  }
+  
+  /// Remove every force field from the pool, releasing their OpenMM
+  /// contexts.
+  public func removeAll() {
+    lock.lock()
+    defer { lock.unlock() }
+    entries.removeAll()
+  }
+  
+  /// Return a force field for the descriptor, creating one only if the pool
+  /// has no compatible force field.
+  ///
+  /// The positions, velocities, and external forces of a reused force field
+  /// match a newly created one. If the descriptor has rigid bodies, their
+  /// state is imported. Otherwise, it is all zero. Other properties, such as
+  /// `timeStep`, keep their values from the previous use.
+  public func dequeue(descriptor: MM4ForceFieldDescriptor) -> MM4ForceField {
+    let key = MM4ForceFieldPoolKey(descriptor: descriptor)
+    lock.lock()
+    let forceField = entries[key]?.popLast()
+    lock.unlock()
+    
+    guard let forceField else {
+      let forceField = MM4ForceField(descriptor: descriptor)
+      forceField.poolKey = key
+      return forceField
+    }
+    forceField.reset(descriptor: descriptor)
+    return forceField
+  }
+  
+  /// Return a force field to the pool, so a later call to
+  /// `dequeue(descriptor:)` can reuse it.
+  ///
+  /// The force field must have been created by this pool, and must not be
+  /// used again until it is dequeued.
+  public func enqueue(_ forceField: MM4ForceField) {
+    guard let key = forceField.poolKey else {
+      fatalError("Force field was not created by a pool.")
+    }
+    lock.lock()
+    entries[key, default: []].append(forceField)
+    lock.unlock()
+  }
+}
+
+/// The settings that determine whether a force field can be reused.
+struct MM4ForceFieldPoolKey: Hashable {
+  var parameters: [MM4Parameters]
+  var parametersHashes: [UInt64]
+  var boxVectors: [SIMD3<Float>]?
+  var cutoffDistance: Float
+  var dielectricConstant: Float
+  var innerStepCount: Int
+  var omitsAnchorInteractions: Bool
+  var platform: ObjectIdentifier?
+  var platformProperties: [String: String]
+  var threadCount: Int?
+  
+  init(descriptor: MM4ForceFieldDescriptor) {
+    if let parameters = descriptor.parameters {
+      self.parameters = [parameters]
+    } else if let rigidBodies = descriptor.rigidBodies {
+      self.parameters = rigidBodies.map(\.parameters)
+    } else {
+      fatalError("Did not specify parameters or rigid bodies.")
+    }
+    parametersHashes = parameters.map(\.contentHash)
+    
+    if let vectors = descriptor.boxVectors {
+      boxVectors = [vectors.a, vectors.b, vectors.c]
+    }
+    cutoffDistance = descriptor.cutoffDistance
+    dielectricConstant = descriptor.dielectricConstant
+    innerStepCount = descriptor.innerStepCount
+    omitsAnchorInteractions = descriptor.omitsAnchorInteractions
+    platform = descriptor.platform.map(ObjectIdentifier.init)
+    platformProperties = descriptor.platformProperties
+    threadCount = descriptor.threadCount
+  }
+  
+  // The parameters are not hashable, so only their hashes are combined. Two
+  // keys with the same hashes still compare every array.
+  func hash(into hasher: inout Hasher) {
+    hasher.combine(parametersHashes)
+    hasher.combine(boxVectors)
+    hasher.combine(cutoffDistance)
+    hasher.combine(dielectricConstant)
+    hasher.combine(innerStepCount)
+    hasher.combine(omitsAnchorInteractions)
+    hasher.combine(platform)
+    hasher.combine(platformProperties)
+    hasher.combine(threadCount)
+  }
+  
+  static func == (lhs: Self, rhs: Self) -> Bool {
+    guard lhs.parametersHashes == rhs.parametersHashes,
+          lhs.boxVectors == rhs.boxVectors,
+          lhs.cutoffDistance == rhs.cutoffDistance,
+          lhs.dielectricConstant == rhs.dielectricConstant,
+          lhs.innerStepCount == rhs.innerStepCount,
+          lhs.omitsAnchorInteractions == rhs.omitsAnchorInteractions,
+          lhs.platform == rhs.platform,
+          lhs.platformProperties == rhs.platformProperties,
+          lhs.threadCount == rhs.threadCount else {
+      return false
+    }
+    return lhs.parameters.elementsEqual(rhs.parameters) {
+      $0.hasSameContent(as: $1)
+    }
+  }
+}
+
+extension MM4Parameters {
+  /// A 64-bit hash of every array that affects the forces.
+  ///
+  /// The lookup tables are derived from the arrays, so they are skipped.
+  var contentHash: UInt64 {
+    var hasher = MM4ParametersHasher()
+    func combine<T>(_ array: [T]) {
+      hasher.combine(UInt64(array.count))
+      array.withUnsafeBytes {
+        hasher.combine(bytes: $0)
+      }
+    }
+    
+    // The payload of a missing element is undefined, so optionals are
+    // hashed one element at a time.
+    func combine<T>(_ array: [T?]) {
+      hasher.combine(UInt64(array.count))
+      for element in array {
+        if let element {
+          hasher.combine(UInt8(1))
+          withUnsafeBytes(of: element) {
+            hasher.combine(bytes: $0)
+          }
+        } else {
+          hasher.combine(UInt8(0))
+        }
+      }
+    }
+    
+    combine(atoms.atomicNumbers)
+    combine(atoms.masses)
+    combine(atoms.parameters)
+    combine(bonds.extendedParameters)
+    combine(bonds.indices)
+    combine(bonds.parameters)
+    combine(angles.extendedParameters)
+    combine(angles.indices)
+    combine(angles.parameters)
+    combine(torsions.extendedParameters)
+    combine(torsions.indices)
+    combine(torsions.parameters)
+    combine(nonbondedExceptions13)
+    combine(nonbondedExceptions14)
+    return hasher.value
+  }
+  
+  /// Whether every array covered by `contentHash` matches another set of
+  /// parameters.
+  func hasSameContent(as other: MM4Parameters) -> Bool {
+    func equal<T>(_ lhs: [T], _ rhs: [T]) -> Bool {
+      guard lhs.count == rhs.count else {
+        return false
+      }
+      return lhs.withUnsafeBytes { lhsBytes in
+        rhs.withUnsafeBytes { rhsBytes in
+          lhsBytes.elementsEqual(rhsBytes)
+        }
+      }
+    }
+    
+    // Like the hash, skip the undefined payload of a missing element.
+    func equal<T>(_ lhs: [T?], _ rhs: [T?]) -> Bool {
+      guard lhs.count == rhs.count else {
+        return false
+      }
+      for (lhsElement, rhsElement) in zip(lhs, rhs) {
+        switch (lhsElement, rhsElement) {
+        case (.none, .none):
+          continue
+        case (.some(let lhsElement), .some(let rhsElement)):
+          let same = withUnsafeBytes(of: lhsElement) { lhsBytes in
+            withUnsafeBytes(of: rhsElement) { rhsBytes in
+              lhsBytes.elementsEqual(rhsBytes)
+            }
+          }
+          guard same else {
+            return false
+          }
+        default:
+          return false
+        }
+      }
+      return true
+    }
+    
+    guard equal(atoms.atomicNumbers, other.atoms.atomicNumbers),
+          equal(atoms.masses, other.atoms.masses),
+          equal(atoms.parameters, other.atoms.parameters),
+          equal(bonds.extendedParameters, other.bonds.extendedParameters),
+          equal(bonds.indices, other.bonds.indices),
+          equal(bonds.parameters, other.bonds.parameters),
+          equal(angles.extendedParameters, other.angles.extendedParameters),
+          equal(angles.indices, other.angles.indices),
+          equal(angles.parameters, other.angles.parameters),
+          equal(torsions.extendedParameters, other.torsions.extendedParameters),
+          equal(torsions.indices, other.torsions.indices),
+          equal(torsions.parameters, other.torsions.parameters),
+          equal(nonbondedExceptions13, other.nonbondedExceptions13),
+          equal(nonbondedExceptions14, other.nonbondedExceptions14) else {
+      return false
+    }
+    return true
+  }
+}
+
+extension MM4ForceField {
+  /// Load the OpenMM plugins once per process.
+  static func loadPlugins() {
+    _ = pluginsLoaded
+  }
+  
+  private static let pluginsLoaded: Bool = {
+    let directory = OpenMM_Platform.defaultPluginsDirectory!
+    _ = OpenMM_Platform.loadPlugins(directory: directory)!
+    return true
+  }()
+  
+  /// Restore the state of a newly created force field.
+  func reset(descriptor: MM4ForceFieldDescriptor) {
+    invalidatePositionsAndVelocities()
+    invalidateForcesAndEnergy()
+    updateRecord.externalForces = true
+    updateRecord.positions = true
+    updateRecord.velocities = true
+    
+    let atomCount = system.parameters.atoms.count
+    let zero = [SIMD3<Float>](repeating: .zero, count: atomCount)
+    _externalForces = zero
+    cachedState.positions = zero
+    cachedState.velocities = zero
+    if let rigidBodies = descriptor.rigidBodies {
+      var atomCursor = 0
+      for rigidBody in rigidBodies {
+        let nextAtomCursor = atomCursor + rigidBody.parameters.atoms.count
+        `import`(from: rigidBody, range: atomCursor..<nextAtomCursor)
+        atomCursor = nextAtomCursor
+      }
+    }
+    _simulationStatistics = MM4SimulationStatistics()
+  }
+}
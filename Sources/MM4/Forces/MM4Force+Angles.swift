@@ -90,6 +90,9 @@ class MM4BendForce: MM4Force {
     for angleID in angles.indices.indices {
       let angle = angles.indices[angleID]
       let parameters = angles.parameters[angleID]
+      if system.isFrozen(angle) {
+        continue
+      }
       
       // Units: millidyne-angstrom/rad^2 -> kJ/mol/rad^2
       //                    kJ/mol/rad^2 -> zJ/rad^2
@@ -230,11 +233,17 @@ class MM4BendBendForce: MM4Force {
       if valenceCount < 3 {
         continue
       }
+      let map = system.parameters.atomsToAtomsMap[atomID]
+      let group = SIMD8(
+        lowHalf: SIMD4<UInt32>(truncatingIfNeeded: map),
+        highHalf: SIMD4(UInt32(truncatingIfNeeded: atomID), .max, .max, .max))
+      if system.isFrozen(group) {
+        continue
+      }
       
       let angleCount = (valenceCount == 3) ? 3 : 6
       let arrayIndex = (valenceCount == 3) ? 0 : 1
       let particles = particleArrays[arrayIndex]
-      let map = system.parameters.atomsToAtomsMap[atomID]
       particles[0] = Int(system.reorderedIndices[atomID])
       
       for i in 0..<valenceCount {
@@ -310,7 +319,8 @@ class MM4BendExtendedForce: MM4Force {
     let angles = system.parameters.angles
     for angleID in angles.indices.indices {
       let angle = angles.indices[angleID]
-      guard let parameters = angles.extendedParameters[angleID] else {
+      guard let parameters = angles.extendedParameters[angleID],
+            !system.isFrozen(angle) else {
         continue
       }
       let originalParameters = angles.parameters[angleID]
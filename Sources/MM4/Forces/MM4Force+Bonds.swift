@@ -39,6 +39,9 @@ class MM4StretchForce: MM4Force {
       // force execution.
       let bond = bonds.indices[bondID]
       let parameters = bonds.parameters[bondID]
+      if system.isFrozen(bond) {
+        continue
+      }
       
       // Units: millidyne-angstrom -> kJ/mol
       //                    kJ/mol -> zJ
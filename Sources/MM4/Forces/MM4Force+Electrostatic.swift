@@ -84,10 +84,15 @@ class MM4ElectrostaticForce: MM4Force {
       );
       """)
     force.addPerParticleParameter(name: "charge")
-    force.nonbondedMethod = .cutoffNonPeriodic
+    if descriptor.boxVectors == nil {
+      force.nonbondedMethod = .cutoffNonPeriodic
+    } else {
+      force.nonbondedMethod = .cutoffPeriodic
+    }
     force.cutoffDistance = Double(descriptor.cutoffDistance)
     
     var forceActive = false
+    var chargedAtomIDs: [Int] = []
     let array = OpenMM_DoubleArray(size: 1)
     let atoms = system.parameters.atoms
     for atomID in system.originalIndices {
@@ -100,8 +105,15 @@ class MM4ElectrostaticForce: MM4Force {
         forceActive = true
       }
     }
+    for atomID in atoms.indices where atoms.parameters[atomID].charge != 0 {
+      chargedAtomIDs.append(atomID)
+    }
     
-    system.createExceptions(force: force)
+    // A pair only contributes energy when both atoms are charged. Most parts
+    // are hydrocarbons with a few polar groups, so the interaction group only
+    // spans the charged atoms. This skips nearly every pair in the neighbor
+    // list, while producing the same energy and forces.
+    system.createExceptions(force: force, atomIDs: chargedAtomIDs)
     super.init(forces: [force], forcesActive: [forceActive], forceGroup: 1)
   }
 }
@@ -368,6 +380,9 @@ class MM4ElectrostaticExceptionForce: MM4Force {
           original[1] = bondLeft[0]
           original[2] = bondRight[0]
           original[3] = bondRight[1]
+          if system.isFrozen(original) {
+            continue
+          }
           
           let reordered = system.virtualSiteReorder(original)
           for lane in 0..<4 {
@@ -46,51 +46,111 @@ class MM4NonbondedForce: MM4Force {
     // minimum of the vdW well is ~0.1 zJ, the crossover with the clamped region
     // occurs on the scale of attojoules. This can be seen by changing the 1000x
     // multiplier for every equation to 1x.
+    //
+    // There are only a few distinct sets of vdW parameters, so particles are
+    // assigned a type, and the combined parameters for every pair of types
+    // are precomputed. The inner loop fetches them from a table, instead of
+    // evaluating the combining rules.
     let force = OpenMM_CustomNonbondedForce(energy: """
       epsilon * (
         -2.25 * (min(2, radius / r))^6 +
         1.84e5 * exp(-12.00 * (r / radius))
       );
-      epsilon = select(isHydrogenBond, heteroatomEpsilon, hydrogenEpsilon);
-      radius = select(isHydrogenBond, heteroatomRadius, hydrogenRadius);
-      
-      isHydrogenBond = step(hydrogenEpsilon1 * hydrogenEpsilon2);
-      heteroatomEpsilon = sqrt(epsilon1 * epsilon2);
-      hydrogenEpsilon = max(hydrogenEpsilon1, hydrogenEpsilon2);
-      heteroatomRadius = radius1 + radius2;
-      hydrogenRadius = max(hydrogenRadius1, hydrogenRadius2);
+      epsilon = epsilonTable(type1, type2);
+      radius = radiusTable(type1, type2);
       """)
-    force.addPerParticleParameter(name: "epsilon")
-    force.addPerParticleParameter(name: "hydrogenEpsilon")
-    force.addPerParticleParameter(name: "radius")
-    force.addPerParticleParameter(name: "hydrogenRadius")
+    force.addPerParticleParameter(name: "type")
     
-    force.nonbondedMethod = .cutoffNonPeriodic
+    if descriptor.boxVectors == nil {
+      force.nonbondedMethod = .cutoffNonPeriodic
+    } else {
+      force.nonbondedMethod = .cutoffPeriodic
+    }
     force.useSwitchingFunction = true
     force.cutoffDistance = Double(descriptor.cutoffDistance)
     force.switchingDistance = Double(
       descriptor.cutoffDistance * pow(1.0 / 3, 1.0 / 6))
     
+    // Assign each distinct set of parameters a type. Type 0 is reserved for
+    // hydrogen nuclei, which interact through their virtual sites instead.
+    // Its combined epsilon is zero, so nuclei stay in the standard neighbor
+    // list without contributing energy. An interaction group would exclude
+    // them too, but it disables the neighbor list.
+    var typeParameters: [MM4AtomParameters?] = [nil]
+    var typeMap: [SIMD4<UInt32>: Int] = [:]
     var forceActive = false
-    let array = OpenMM_DoubleArray(size: 4)
+    let array = OpenMM_DoubleArray(size: 1)
     let atoms = system.parameters.atoms
-    for atomID in system.originalIndices {
+    for (particleID, atomID) in system.originalIndices.enumerated() {
+      guard particleID >= system.virtualSiteCount else {
+        array[0] = 0
+        force.addParticle(parameters: array)
+        continue
+      }
       let parameters = atoms.parameters[Int(atomID)]
+      let key = SIMD4(
+        parameters.epsilon.default.bitPattern,
+        parameters.epsilon.hydrogen.bitPattern,
+        parameters.radius.default.bitPattern,
+        parameters.radius.hydrogen.bitPattern)
       
-      // Units: kcal/mol -> kJ/mol
-      //          kJ/mol -> zJ
-      let (epsilon, hydrogenEpsilon) = parameters.epsilon
-      array[0] = Double(epsilon) * OpenMM_KJPerKcal * MM4ZJPerKJPerMol
-      array[1] = Double(hydrogenEpsilon) * OpenMM_KJPerKcal * MM4ZJPerKJPerMol
-      
-      // Units: angstrom -> nm
-      let (radius, hydrogenRadius) = parameters.radius
-      array[2] = Double(radius) * OpenMM_NmPerAngstrom
-      array[3] = Double(hydrogenRadius) * OpenMM_NmPerAngstrom
+      let type: Int
+      if let existingType = typeMap[key] {
+        type = existingType
+      } else {
+        type = typeParameters.count
+        typeMap[key] = type
+        typeParameters.append(parameters)
+      }
+      array[0] = Double(type)
       force.addParticle(parameters: array)
       forceActive = true
     }
     
+    // Apply the combining rules to every pair of types.
+    let typeCount = typeParameters.count
+    let epsilonTable = OpenMM_DoubleArray(size: typeCount * typeCount)
+    let radiusTable = OpenMM_DoubleArray(size: typeCount * typeCount)
+    for type1 in typeParameters.indices {
+      for type2 in typeParameters.indices {
+        let index = type1 + typeCount * type2
+        guard let parameters1 = typeParameters[type1],
+              let parameters2 = typeParameters[type2] else {
+          // Keep the radius nonzero, so the expression stays finite.
+          epsilonTable[index] = 0
+          radiusTable[index] = 1
+          continue
+        }
+        
+        let epsilon: Float
+        let radius: Float
+        if parameters1.epsilon.hydrogen * parameters2.epsilon.hydrogen < 0 {
+          epsilon = max(parameters1.epsilon.hydrogen,
+                        parameters2.epsilon.hydrogen)
+          radius = max(parameters1.radius.hydrogen,
+                       parameters2.radius.hydrogen)
+        } else {
+          epsilon = sqrt(parameters1.epsilon.default *
+                         parameters2.epsilon.default)
+          radius = parameters1.radius.default +
+          /**/     parameters2.radius.default
+        }
+        
+        // Units: kcal/mol -> zJ, angstrom -> nm
+        epsilonTable[index] =
+          Double(epsilon) * OpenMM_KJPerKcal * MM4ZJPerKJPerMol
+        radiusTable[index] = Double(radius) * OpenMM_NmPerAngstrom
+      }
+    }
+    force.addTabulatedFunction(
+      name: "epsilonTable",
+      function: OpenMM_Discrete2DFunction(
+        xSize: typeCount, ySize: typeCount, values: epsilonTable))
+    force.addTabulatedFunction(
+      name: "radiusTable",
+      function: OpenMM_Discrete2DFunction(
+        xSize: typeCount, ySize: typeCount, values: radiusTable))
+    
     system.createExceptions(force: force)
     super.init(forces: [force], forcesActive: [forceActive], forceGroup: 1)
   }
@@ -142,6 +202,9 @@ class MM4NonbondedExceptionForce: MM4Force {
     let exceptions = system.parameters.nonbondedExceptions14
     let atoms = system.parameters.atoms
     for exception in exceptions {
+      if system.isFrozen(exception) {
+        continue
+      }
       let parameters1 = atoms.parameters[Int(exception[0])]
       let parameters2 = atoms.parameters[Int(exception[1])]
       
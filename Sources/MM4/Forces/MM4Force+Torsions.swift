@@ -10,13 +10,8 @@ import OpenMM
 /// Torsion and torsion-stretch force.
 class MM4TorsionForce: MM4Force {
   required init(system: MM4System, descriptor: MM4ForceFieldDescriptor) {
-    // Eventually, we want to optimize this by fusing all the torsions
-    // surrounding the same bond into a single invocation.
-    //
-    // Perhaps only do this for bonds that have no heteroatoms immediately next
-    // to them. This should optimize bulk diamond and moissanite, without
-    // introducing extra computation for highly mixed-element compounds. There
-    // should be a separate force object for this.
+    // Torsions around bonds between carbon-like atoms are fused into a single
+    // invocation, in 'MM4TorsionFusedForce'. This force handles the rest.
     let force = OpenMM_CustomCompoundBondForce(numParticles: 4, energy: """
       torsion + torsionStretch;
       torsion = V1 * fourierExpansion1
@@ -52,6 +47,13 @@ class MM4TorsionForce: MM4Force {
         // Compute heteroatom V1/V2/V3 terms in the extended force.
         continue
       }
+      if system.torsionFusion.fusedMask[torsionID] {
+        // Compute carbon-like torsions in the fused force.
+        continue
+      }
+      if system.isFrozen(torsion) {
+        continue
+      }
       
       // Units: kcal/mol -> kJ/mol
       //          kJ/mol -> zJ
@@ -190,6 +192,9 @@ class MM4TorsionExtendedForce: MM4Force {
       guard originalParameters.n == 2 else {
         fatalError("'n' must be two for extended torsions.")
       }
+      if system.isFrozen(torsion) {
+        continue
+      }
       
       // MARK: - Torsion
       
@@ -304,3 +309,181 @@ class MM4TorsionExtendedForce: MM4Force {
     super.init(forces: [force], forcesActive: [forceActive], forceGroup: 1)
   }
 }
+
+/// Torsion and torsion-stretch force for the 9 torsions surrounding a bond
+/// between two carbon-like atoms.
+///
+/// The central bond's length is computed once per invocation, instead of once
+/// per torsion. This optimizes bulk diamond, silicon, and moissanite, without
+/// introducing extra computation for highly mixed-element compounds.
+class MM4TorsionFusedForce: MM4Force {
+  required init(system: MM4System, descriptor: MM4ForceFieldDescriptor) {
+    // Particles 1 and 2 form the central bond. Particles 3-5 are bonded to
+    // particle 1, and particles 6-8 are bonded to particle 2.
+    var energy = (0..<9).map { "torsion\($0)" }.joined(separator: " + ")
+    energy += ";\n"
+    for torsionID in 0..<9 {
+      let left = 3 + torsionID / 3
+      let right = 6 + torsionID % 3
+      energy += """
+        torsion\(torsionID) = V1_\(torsionID) * (1 + cos(omega\(torsionID)))
+          + Vn_\(torsionID) * (1 - cos(n_\(torsionID) * omega\(torsionID)))
+          + (V3_\(torsionID) + Kts3_\(torsionID) * deltaLength)
+          * (1 + cos(3 * omega\(torsionID)));
+        omega\(torsionID) = dihedral(p\(left), p1, p2, p\(right));
+        
+        """
+    }
+    energy += "deltaLength = distance(p1, p2) - equilibriumLength;"
+    let force = OpenMM_CustomCompoundBondForce(numParticles: 8, energy: energy)
+    for torsionID in 0..<9 {
+      force.addPerBondParameter(name: "V1_\(torsionID)")
+      force.addPerBondParameter(name: "Vn_\(torsionID)")
+      force.addPerBondParameter(name: "V3_\(torsionID)")
+      force.addPerBondParameter(name: "n_\(torsionID)")
+      force.addPerBondParameter(name: "Kts3_\(torsionID)")
+    }
+    force.addPerBondParameter(name: "equilibriumLength")
+    var forceActive = false
+    
+    let particles = OpenMM_IntArray(size: 8)
+    let array = OpenMM_DoubleArray(size: 9 * 5 + 1)
+    let bonds = system.parameters.bonds
+    let torsions = system.parameters.torsions
+    let fusion = system.torsionFusion
+    for groupID in fusion.bondIDs.indices {
+      if system.isFrozen(fusion.particles[groupID]) {
+        continue
+      }
+      for lane in 0..<9 {
+        let torsionID = Int(fusion.torsionIDs[9 * groupID + lane])
+        let parameters = torsions.parameters[torsionID]
+        
+        // Units: kcal/mol -> kJ/mol
+        //          kJ/mol -> zJ
+        //
+        // WARNING: Divide all Vn torsion parameters by 2.
+        let unitConversionFactor = OpenMM_KJPerKcal * MM4ZJPerKJPerMol
+        array[5 * lane + 0] = Double(parameters.V1) * unitConversionFactor / 2
+        array[5 * lane + 1] = Double(parameters.Vn) * unitConversionFactor / 2
+        array[5 * lane + 2] = Double(parameters.V3) * unitConversionFactor / 2
+        array[5 * lane + 3] = Double(parameters.n)
+        
+        // Units: kcal/mol/angstrom -> kJ/mol/angstrom
+        //          kJ/mol/angstrom -> kJ/mol/nm
+        //                kJ/mol/nm -> zJ/nm
+        var Kts3 = Double(parameters.Kts3)
+        Kts3 *= OpenMM_KJPerKcal
+        Kts3 /= OpenMM_NmPerAngstrom
+        Kts3 *= MM4ZJPerKJPerMol
+        array[5 * lane + 4] = Kts3
+      }
+      
+      // Units: angstrom -> nm
+      let bondID = Int(fusion.bondIDs[groupID])
+      let bondParameters = bonds.parameters[bondID]
+      var equilibriumLength = Double(bondParameters.equilibriumLength)
+      equilibriumLength *= OpenMM_NmPerAngstrom
+      array[9 * 5] = equilibriumLength
+      
+      let group = fusion.particles[groupID]
+      let reorderedLower = system.reorder(group.lowHalf)
+      let reorderedUpper = system.reorder(group.highHalf)
+      for lane in 0..<4 {
+        particles[lane] = reorderedLower[lane]
+        particles[4 + lane] = reorderedUpper[lane]
+      }
+      force.addBond(particles: particles, parameters: array)
+      forceActive = true
+    }
+    super.init(forces: [force], forcesActive: [forceActive], forceGroup: 1)
+  }
+}
+
+/// The bonds whose torsions are evaluated by the fused torsion force.
+struct MM4TorsionFusion {
+  /// The central bond of each group.
+  var bondIDs: [UInt32] = []
+  
+  /// The atoms in each group, in the order expected by the fused force.
+  var particles: [SIMD8<UInt32>] = []
+  
+  /// The 9 torsions in each group, ordered by left atom, then right atom.
+  var torsionIDs: [UInt32] = []
+  
+  /// Whether each torsion is evaluated by the fused force.
+  var fusedMask: [Bool] = []
+  
+  init(parameters: MM4Parameters) {
+    let atoms = parameters.atoms
+    let torsions = parameters.torsions
+    fusedMask = Array(repeating: false, count: torsions.indices.count)
+    guard torsions.parameters.count == torsions.indices.count else {
+      return
+    }
+    
+    @inline(__always)
+    func isCarbonLike(_ atomID: UInt32) -> Bool {
+      switch atoms.atomicNumbers[Int(atomID)] {
+      case 6, 14, 32: return true
+      default: return false
+      }
+    }
+    
+    // Collect the three substituents on one side of the bond.
+    @inline(__always)
+    func substituents(
+      _ atomID: UInt32, excluding otherID: UInt32
+    ) -> [UInt32]? {
+      let map = parameters.atomsToAtomsMap[Int(atomID)]
+      var output: [UInt32] = []
+      for lane in 0..<4 where map[lane] != -1 {
+        let neighborID = UInt32(truncatingIfNeeded: map[lane])
+        guard neighborID != otherID else {
+          continue
+        }
+        guard isCarbonLike(neighborID) ||
+                atoms.atomicNumbers[Int(neighborID)] == 1 else {
+          return nil
+        }
+        output.append(neighborID)
+      }
+      return (output.count == 3) ? output : nil
+    }
+    
+    var groupTorsionIDs: [UInt32] = []
+    groupTorsionIDs.reserveCapacity(9)
+    for (bondID, bond) in parameters.bonds.indices.enumerated() {
+      guard isCarbonLike(bond[0]), isCarbonLike(bond[1]),
+            let left = substituents(bond[0], excluding: bond[1]),
+            let right = substituents(bond[1], excluding: bond[0]) else {
+        continue
+      }
+      
+      // Heteroatom torsions stay in the extended force.
+      groupTorsionIDs.removeAll(keepingCapacity: true)
+      for leftID in left {
+        for rightID in right {
+          let torsion = SIMD4(leftID, bond[0], bond[1], rightID)
+          guard let torsionID = torsions.map[torsion],
+                torsions.extendedParameters[Int(torsionID)] == nil else {
+            break
+          }
+          groupTorsionIDs.append(torsionID)
+        }
+      }
+      guard groupTorsionIDs.count == 9 else {
+        continue
+      }
+      
+      bondIDs.append(UInt32(truncatingIfNeeded: bondID))
+      particles.append(SIMD8(
+        bond[0], bond[1], left[0], left[1], left[2],
+        right[0], right[1], right[2]))
+      torsionIDs += groupTorsionIDs
+      for torsionID in groupTorsionIDs {
+        fusedMask[Int(torsionID)] = true
+      }
+    }
+  }
+}
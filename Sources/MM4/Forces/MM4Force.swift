@@ -72,6 +72,18 @@ class MM4Force {
       system.addForce(force)
     }
   }
+  
+  /// Compute bonded interactions between the nearest periodic images, so
+  /// bonds may cross the boundaries of the cell.
+  func usePeriodicBoundaryConditions() {
+    for force in forces {
+      if let force = force as? OpenMM_CustomBondForce {
+        force.usesPeriodicBoundaryConditions = true
+      } else if let force = force as? OpenMM_CustomCompoundBondForce {
+        force.usesPeriodicBoundaryConditions = true
+      }
+    }
+  }
 }
 
 /// Wraps all the forces owned by a system.
@@ -84,6 +96,7 @@ class MM4Forces {
   var nonbondedException: MM4NonbondedExceptionForce
   var torsion: MM4TorsionForce
   var torsionExtended: MM4TorsionExtendedForce
+  var torsionFused: MM4TorsionFusedForce
   
   // Force Group 2
   var bend: MM4BendForce
@@ -100,12 +113,22 @@ class MM4Forces {
     self.nonbondedException = .init(system: system, descriptor: descriptor)
     self.torsion = .init(system: system, descriptor: descriptor)
     self.torsionExtended = .init(system: system, descriptor: descriptor)
+    self.torsionFused = .init(system: system, descriptor: descriptor)
     
     // Force Group 2
     self.bend = .init(system: system, descriptor: descriptor)
     self.bendBend = .init(system: system, descriptor: descriptor)
     self.bendExtended = .init(system: system, descriptor: descriptor)
     self.stretch = .init(system: system, descriptor: descriptor)
+    
+    if descriptor.boxVectors != nil {
+      for force in [
+        electrostaticException, nonbondedException, torsion, torsionExtended,
+        torsionFused, bend, bendBend, bendExtended, stretch,
+      ] as [MM4Force] {
+        force.usePeriodicBoundaryConditions()
+      }
+    }
   }
   
   func addForces(to system: OpenMM_System) {
@@ -117,6 +140,7 @@ class MM4Forces {
     nonbondedException.addForces(to: system)
     torsion.addForces(to: system)
     torsionExtended.addForces(to: system)
+    torsionFused.addForces(to: system)
     
     // Force Group 2
     bend.addForces(to: system)
@@ -5,6 +5,7 @@
 //  Created by Philip Turner on 10/20/23.
 //
 
+import Foundation
 import OpenMM
 
 /// Identifying information for an atom.
@@ -26,6 +27,11 @@ public enum MM4Error: Error {
   /// Includes the addresses of the atoms.
   case missingParameter([MM4Address])
   
+  /// A file did not conform to the expected binary format.
+  ///
+  /// Includes the location of the file.
+  case invalidFileFormat(URL)
+  
   /// The atom's bond count did not match its valence.
   ///
   /// Includes the address of the atom, and the atoms it was detected as bonding
@@ -0,0 +1,175 @@
+//
+//  MM4Parameters+Append.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import Dispatch
+
+extension MM4Parameters {
+  /// Combine the parameters of several structures into one.
+  ///
+  /// The result is the same as starting from empty parameters and calling
+  /// `append(contentsOf:)` for each element in order. Every array is allocated
+  /// once, and the elements are copied in parallel. This is much faster when
+  /// combining many small structures, such as the rigid bodies in a force
+  /// field.
+  ///
+  /// An empty array produces empty parameters with the default settings of
+  /// `MM4ParametersDescriptor`.
+  public init(concatenating components: [MM4Parameters]) {
+    // Compute where each component's atoms and bonds begin.
+    var atomOffsets: [UInt32] = []
+    var bondOffsets: [UInt32] = []
+    var atomCount: Int = 0
+    var bondCount: Int = 0
+    atomOffsets.reserveCapacity(components.count)
+    bondOffsets.reserveCapacity(components.count)
+    for component in components {
+      atomOffsets.append(UInt32(truncatingIfNeeded: atomCount))
+      bondOffsets.append(UInt32(truncatingIfNeeded: bondCount))
+      atomCount += component.atoms.count
+      bondCount += component.bonds.indices.count
+    }
+    guard atomCount < Int32.max, bondCount < Int32.max else {
+      fatalError("Too many atoms or bonds.")
+    }
+    
+    @inline(__always)
+    func copy<T>(_ elements: (MM4Parameters) -> [T]) -> [T] {
+      MM4Parameters.concatenate(components, elements) { element, _ in element }
+    }
+    @inline(__always)
+    func shift<T: SIMD>(
+      _ elements: (MM4Parameters) -> [T]
+    ) -> [T] where T.Scalar == UInt32 {
+      MM4Parameters.concatenate(components, elements) { element, componentID in
+        let modified = element &+ atomOffsets[componentID]
+        return element.replacing(with: modified, where: element .< UInt32.max)
+      }
+    }
+    
+    atoms.atomicNumbers = copy { $0.atoms.atomicNumbers }
+    atoms.centerTypes = copy { $0.atoms.centerTypes }
+    atoms.codes = copy { $0.atoms.codes }
+    atoms.count = atomCount
+    atoms.indices = 0..<atomCount
+    atoms.masses = copy { $0.atoms.masses }
+    atoms.parameters = copy { $0.atoms.parameters }
+    atoms.ringTypes = copy { $0.atoms.ringTypes }
+    
+    bonds.extendedParameters = copy { $0.bonds.extendedParameters }
+    bonds.indices = shift { $0.bonds.indices }
+    bonds.parameters = copy { $0.bonds.parameters }
+    bonds.ringTypes = copy { $0.bonds.ringTypes }
+    
+    angles.extendedParameters = copy { $0.angles.extendedParameters }
+    angles.indices = shift { $0.angles.indices }
+    angles.parameters = copy { $0.angles.parameters }
+    angles.ringTypes = copy { $0.angles.ringTypes }
+    
+    torsions.extendedParameters = copy { $0.torsions.extendedParameters }
+    torsions.indices = shift { $0.torsions.indices }
+    torsions.parameters = copy { $0.torsions.parameters }
+    torsions.ringTypes = copy { $0.torsions.ringTypes }
+    
+    rings.indices = shift { $0.rings.indices }
+    rings.ringTypes = copy { $0.rings.ringTypes }
+    
+    nonbondedExceptions13 = shift { $0.nonbondedExceptions13 }
+    nonbondedExceptions14 = shift { $0.nonbondedExceptions14 }
+    atomsToBondsMap = MM4Parameters.concatenate(
+      components, { $0.atomsToBondsMap }
+    ) { element, componentID in
+      let offset = Int32(truncatingIfNeeded: bondOffsets[componentID])
+      let modified = element &+ offset
+      return element.replacing(with: modified, where: element .>= 0)
+    }
+    atomsToAtomsMap = MM4Parameters.concatenate(
+      components, { $0.atomsToAtomsMap }
+    ) { element, componentID in
+      let offset = Int32(truncatingIfNeeded: atomOffsets[componentID])
+      let modified = element &+ offset
+      return element.replacing(with: modified, where: element .>= 0)
+    }
+    if let first = components.first {
+      forces = first.forces
+      hydrogenMassScale = first.hydrogenMassScale
+    } else {
+      // Empty parameters keep the default settings, so they can be edited.
+      let descriptor = MM4ParametersDescriptor()
+      forces = descriptor.forces
+      hydrogenMassScale = descriptor.hydrogenMassScale
+    }
+    for component in components {
+      if forces != component.forces {
+        forces = nil
+      }
+      if hydrogenMassScale != component.hydrogenMassScale {
+        hydrogenMassScale = nil
+      }
+    }
+    
+    // Build the lookup tables from the flat arrays, instead of merging every
+    // component's table. The tables are independent, so they are built
+    // simultaneously.
+    var bondsMap = MM4GroupMap<SIMD2<UInt32>>()
+    var anglesMap = MM4GroupMap<SIMD3<UInt32>>()
+    var torsionsMap = MM4GroupMap<SIMD4<UInt32>>()
+    var ringsMap = MM4GroupMap<SIMD8<UInt32>>()
+    let bondIndices = bonds.indices
+    let angleIndices = angles.indices
+    let torsionIndices = torsions.indices
+    let ringIndices = rings.indices
+    DispatchQueue.concurrentPerform(iterations: 4) { taskID in
+      switch taskID {
+      case 0: bondsMap = MM4GroupMap(bondIndices)
+      case 1: anglesMap = MM4GroupMap(angleIndices)
+      case 2: torsionsMap = MM4GroupMap(torsionIndices)
+      case 3: ringsMap = MM4GroupMap(ringIndices)
+      default: fatalError("This should never happen.")
+      }
+    }
+    bonds.map = bondsMap
+    angles.map = anglesMap
+    torsions.map = torsionsMap
+    rings.map = ringsMap
+  }
+}
+
+extension MM4Parameters {
+  /// Concatenate one array from each component, transforming each element
+  /// with the index of its component.
+  static func concatenate<T>(
+    _ components: [MM4Parameters],
+    _ elements: (MM4Parameters) -> [T],
+    _ transform: (T, Int) -> T
+  ) -> [T] {
+    var offsets: [Int] = []
+    offsets.reserveCapacity(components.count + 1)
+    var count: Int = 0
+    for component in components {
+      offsets.append(count)
+      count += elements(component).count
+    }
+    offsets.append(count)
+    
+    return Array(unsafeUninitializedCapacity: count) { buffer, outputCount in
+      let baseAddress = buffer.baseAddress
+      let iterations = components.count
+      DispatchQueue.concurrentPerform(iterations: iterations) { componentID in
+        let source = elements(components[componentID])
+        guard source.count > 0, let baseAddress else {
+          return
+        }
+        let target = baseAddress.advanced(by: offsets[componentID])
+        for i in source.indices {
+          let element = transform(source[i], componentID)
+          target.advanced(by: i).initialize(to: element)
+        }
+      }
+      outputCount = count
+    }
+  }
+}
@@ -34,6 +34,7 @@ public struct MM4Atoms {
   mutating func append(contentsOf other: Self, atomOffset: UInt32) {
     self.atomicNumbers += other.atomicNumbers
     self.centerTypes += other.centerTypes
+    self.codes += other.codes
     self.count += other.count
     self.indices = 0..<self.count
     self.masses += other.masses
@@ -16,7 +16,7 @@ public struct MM4Bonds {
   public var indices: [SIMD2<UInt32>] = []
   
   /// Map from a group of atoms to a bond index.
-  public var map: [SIMD2<UInt32>: UInt32] = [:]
+  public var map: MM4GroupMap<SIMD2<UInt32>> = MM4GroupMap()
   
   /// Each value corresponds to the bond at the same array index.
   public var parameters: [MM4BondParameters] = []
@@ -25,15 +25,12 @@ public struct MM4Bonds {
   public var ringTypes: [UInt8] = []
   
   mutating func append(contentsOf other: Self, atomOffset: UInt32) {
-    let bondOffset = UInt32(self.indices.count)
     self.extendedParameters += other.extendedParameters
+    self.map.keys = []
     self.indices += other.indices.map {
       $0 &+ atomOffset
     }
-    for key in other.map.keys {
-      let value = other.map[key].unsafelyUnwrapped
-      self.map[key &+ atomOffset] = value &+ bondOffset
-    }
+    self.map.append(contentsOf: other.map, keys: self.indices)
     self.parameters += other.parameters
     self.ringTypes += other.ringTypes
   }
@@ -41,7 +38,6 @@ public struct MM4Bonds {
   mutating func reserveCapacity(_ minimumCapacity: Int) {
     extendedParameters.reserveCapacity(minimumCapacity)
     indices.reserveCapacity(minimumCapacity)
-    map.reserveCapacity(minimumCapacity)
     parameters.reserveCapacity(minimumCapacity)
     ringTypes.reserveCapacity(minimumCapacity)
   }
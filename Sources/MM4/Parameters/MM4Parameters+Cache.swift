@@ -0,0 +1,493 @@
+//
+//  MM4Parameters+Cache.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import Foundation
+
+extension MM4ParametersDescriptor {
+  /// A 64-bit hash of every property that affects the generated parameters.
+  ///
+  /// Bonds are hashed after sorting the indices within each bond, the same way
+  /// `MM4Parameters` stores them. The order of atoms and bonds is significant.
+  /// The key also includes the version of the parameters, so entries created
+  /// by an older version of MM4 are not reused.
+  public var cacheKey: UInt64 {
+    guard let atomicNumbers, let bonds else {
+      fatalError("Descriptor did not have the required properties.")
+    }
+    var hasher = MM4ParametersHasher()
+    hasher.combine(MM4ParametersHeader.parametersVersion)
+    hasher.combine(UInt64(atomicNumbers.count))
+    hasher.combine(UInt64(bonds.count))
+    atomicNumbers.withUnsafeBytes {
+      hasher.combine(bytes: $0)
+    }
+    for bond in bonds {
+      hasher.combine(bond.min())
+      hasher.combine(bond.max())
+    }
+    hasher.combine(forces.rawValue)
+    hasher.combine(hydrogenMassScale.bitPattern)
+    return hasher.value
+  }
+}
+
+extension MM4Parameters {
+  /// Load a set of parameters from a cache, or create them and add them to the
+  /// cache.
+  ///
+  /// - Parameter descriptor: The configuration of the parameters.
+  /// - Parameter cacheDirectory: The directory holding the cache. It is
+  ///   created if it does not exist. Each entry's file name is derived from
+  ///   the descriptor's `cacheKey`.
+  /// - throws: An error if there wasn't a parameter for a certain atom pair, or
+  ///   the descriptor was invalid.
+  ///
+  /// The cache is a performance optimization, not a source of truth. Entries
+  /// that are missing, corrupted, written by a different build of MM4, or
+  /// that collide with another descriptor's hash are silently regenerated.
+  /// Every array is validated before use. Enumeration cases and optionals
+  /// must be valid, array lengths must agree, and atom indices must be in
+  /// range.
+  public init(
+    descriptor: MM4ParametersDescriptor,
+    cacheDirectory: URL
+  ) throws {
+    let key = descriptor.cacheKey
+    var fileName = String(key, radix: 16)
+    fileName = String(repeating: "0", count: 16 - fileName.count) + fileName
+    let url = cacheDirectory.appendingPathComponent("\(fileName).mm4p")
+    
+    if let cached = MM4Parameters(cacheURL: url, descriptor: descriptor) {
+      self = cached
+      return
+    }
+    
+    try self.init(descriptor: descriptor)
+    try? FileManager.default.createDirectory(
+      at: cacheDirectory, withIntermediateDirectories: true)
+    try? write(to: url, descriptor: descriptor)
+  }
+  
+  /// Load a set of parameters from a cache entry.
+  ///
+  /// Returns `nil` if the file is missing or incomplete, was created by a build
+  /// of MM4 with a different memory layout, holds inconsistent arrays, or was
+  /// created from a different descriptor.
+  init?(cacheURL url: URL, descriptor: MM4ParametersDescriptor) {
+    guard let data = try? Data(contentsOf: url, options: .alwaysMapped) else {
+      return nil
+    }
+    var decoder = MM4ParametersDecoder(data: data)
+    guard decoder.decodeHeader(),
+          decoder.header.key == descriptor.cacheKey,
+          decoder.header.forces == descriptor.forces.rawValue,
+          decoder.header.hydrogenMassScale ==
+            descriptor.hydrogenMassScale.bitPattern else {
+      return nil
+    }
+    
+    atoms.atomicNumbers = decoder.decode()
+    atoms.centerTypes = decoder.decodeOptionalEnumerations()
+    atoms.codes = decoder.decodeEnumerations()
+    atoms.masses = decoder.decode()
+    atoms.parameters = decoder.decode()
+    atoms.ringTypes = decoder.decode()
+    atoms.count = atoms.atomicNumbers.count
+    atoms.indices = 0..<atoms.count
+    forces = descriptor.forces
+    hydrogenMassScale = descriptor.hydrogenMassScale
+    
+    bonds.extendedParameters = decoder.decodeOptionals()
+    bonds.indices = decoder.decode()
+    bonds.parameters = decoder.decode()
+    bonds.ringTypes = decoder.decode()
+    
+    angles.extendedParameters = decoder.decodeOptionals()
+    angles.indices = decoder.decode()
+    angles.parameters = decoder.decode()
+    angles.ringTypes = decoder.decode()
+    
+    torsions.extendedParameters = decoder.decodeOptionals()
+    torsions.indices = decoder.decode()
+    torsions.parameters = decoder.decode()
+    torsions.ringTypes = decoder.decode()
+    
+    rings.indices = decoder.decode()
+    rings.ringTypes = decoder.decode()
+    
+    nonbondedExceptions13 = decoder.decode()
+    nonbondedExceptions14 = decoder.decode()
+    atomsToBondsMap = decoder.decode()
+    atomsToAtomsMap = decoder.decode()
+    guard decoder.valid, decoder.cursor == data.count,
+          isConsistent(), matches(descriptor: descriptor) else {
+      return nil
+    }
+    
+    // The maps are not serialized. Each one maps a group of atoms to its
+    // position in the corresponding array of indices.
+    bonds.map = MM4GroupMap(bonds.indices)
+    angles.map = MM4GroupMap(angles.indices)
+    torsions.map = MM4GroupMap(torsions.indices)
+    rings.map = MM4GroupMap(rings.indices)
+  }
+  
+  /// Serialize the parameters into a file readable by a cache.
+  func write(to url: URL, descriptor: MM4ParametersDescriptor) throws {
+    var encoder = MM4ParametersEncoder()
+    var header = MM4ParametersHeader()
+    header.key = descriptor.cacheKey
+    header.forces = descriptor.forces.rawValue
+    header.hydrogenMassScale = descriptor.hydrogenMassScale.bitPattern
+    encoder.encode(header: header)
+    
+    encoder.encode(atoms.atomicNumbers)
+    encoder.encode(optionals: atoms.centerTypes.map { $0?.rawValue })
+    encoder.encode(atoms.codes.map(\.rawValue))
+    encoder.encode(atoms.masses)
+    encoder.encode(atoms.parameters)
+    encoder.encode(atoms.ringTypes)
+    
+    encoder.encode(optionals: bonds.extendedParameters)
+    encoder.encode(bonds.indices)
+    encoder.encode(bonds.parameters)
+    encoder.encode(bonds.ringTypes)
+    
+    encoder.encode(optionals: angles.extendedParameters)
+    encoder.encode(angles.indices)
+    encoder.encode(angles.parameters)
+    encoder.encode(angles.ringTypes)
+    
+    encoder.encode(optionals: torsions.extendedParameters)
+    encoder.encode(torsions.indices)
+    encoder.encode(torsions.parameters)
+    encoder.encode(torsions.ringTypes)
+    
+    encoder.encode(rings.indices)
+    encoder.encode(rings.ringTypes)
+    
+    encoder.encode(nonbondedExceptions13)
+    encoder.encode(nonbondedExceptions14)
+    encoder.encode(atomsToBondsMap)
+    encoder.encode(atomsToAtomsMap)
+    try encoder.data.write(to: url, options: .atomic)
+  }
+  
+  /// Check that the decoded arrays have matching lengths, and that every
+  /// index is in range.
+  func isConsistent() -> Bool {
+    let atomCount = atoms.count
+    guard atoms.centerTypes.count == atomCount,
+          atoms.codes.count == atomCount,
+          atoms.masses.count == atomCount,
+          atoms.parameters.count == atomCount,
+          atoms.ringTypes.count == atomCount,
+          atomsToBondsMap.count == atomCount,
+          atomsToAtomsMap.count == atomCount else {
+      return false
+    }
+    
+    // Every lane must be a valid atom index, or `.max` in a padded lane.
+    func inRange<T: SIMD>(
+      _ groups: [T], padded: Bool
+    ) -> Bool where T.Scalar == UInt32 {
+      let bound = UInt32(truncatingIfNeeded: atomCount)
+      for group in groups {
+        for lane in 0..<group.scalarCount {
+          let index = group[lane]
+          guard index < bound || (padded && index == .max) else {
+            return false
+          }
+        }
+      }
+      return true
+    }
+    func mapInRange(_ map: [SIMD4<Int32>], count: Int) -> Bool {
+      let bound = Int32(truncatingIfNeeded: count)
+      for element in map {
+        guard all(element .>= -1), all(element .< bound) else {
+          return false
+        }
+      }
+      return true
+    }
+    
+    let bondCount = bonds.indices.count
+    let angleCount = angles.indices.count
+    let torsionCount = torsions.indices.count
+    guard bonds.extendedParameters.count == bondCount,
+          bonds.parameters.count == bondCount,
+          bonds.ringTypes.count == bondCount,
+          angles.extendedParameters.count == angleCount,
+          angles.parameters.count == angleCount,
+          angles.ringTypes.count == angleCount,
+          torsions.extendedParameters.count == torsionCount,
+          torsions.parameters.count == torsionCount,
+          torsions.ringTypes.count == torsionCount,
+          rings.ringTypes.count == rings.indices.count else {
+      return false
+    }
+    guard inRange(bonds.indices, padded: false),
+          inRange(angles.indices, padded: false),
+          inRange(torsions.indices, padded: false),
+          inRange(rings.indices, padded: true),
+          inRange(nonbondedExceptions13, padded: false),
+          inRange(nonbondedExceptions14, padded: false),
+          mapInRange(atomsToBondsMap, count: bondCount),
+          mapInRange(atomsToAtomsMap, count: atomCount) else {
+      return false
+    }
+    return true
+  }
+  
+  /// Guard against hash collisions by comparing the parameters to the
+  /// descriptor that would have created them.
+  func matches(descriptor: MM4ParametersDescriptor) -> Bool {
+    guard let atomicNumbers = descriptor.atomicNumbers,
+          let descriptorBonds = descriptor.bonds else {
+      return false
+    }
+    guard atoms.atomicNumbers == atomicNumbers,
+          bonds.indices.count == descriptorBonds.count else {
+      return false
+    }
+    for bondID in descriptorBonds.indices {
+      let bond = descriptorBonds[bondID]
+      guard bonds.indices[bondID] == SIMD2(bond.min(), bond.max()) else {
+        return false
+      }
+    }
+    return true
+  }
+}
+
+// MARK: - Binary Format
+
+// The file is a header, followed by a sequence of arrays. Each array starts
+// with its element count and stride, then the raw bytes of its elements,
+// padded to 8 bytes. Elements are copied without conversion, so the file is
+// only valid for builds of MM4 with the same memory layout. The layout is
+// fingerprinted in the header.
+//
+// Enumerations are stored as raw values. Optionals are stored as an array of
+// presence flags, followed by an array of payloads. Neither is copied
+// directly, because an arbitrary bit pattern may not be a valid instance.
+struct MM4ParametersHeader {
+  // The bytes "MM4P".
+  static let magic: UInt32 = 0x5034_4D4D
+  static let version: UInt32 = 2
+  
+  // Increment whenever a change to MM4 alters the parameters created from
+  // the same descriptor.
+  static let parametersVersion: UInt32 = 1
+  
+  var key: UInt64 = 0
+  var forces: UInt32 = 0
+  var hydrogenMassScale: UInt32 = 0
+  
+  static var layoutFingerprint: UInt64 {
+    var hasher = MM4ParametersHasher()
+    func combine<T>(_ type: T.Type) {
+      hasher.combine(UInt64(MemoryLayout<T>.size))
+      hasher.combine(UInt64(MemoryLayout<T>.stride))
+      hasher.combine(UInt64(MemoryLayout<T>.alignment))
+    }
+    combine(MM4AtomParameters.self)
+    combine(MM4BondParameters.self)
+    combine(MM4BondExtendedParameters.self)
+    combine(MM4AngleParameters.self)
+    combine(MM4AngleExtendedParameters.self)
+    combine(MM4TorsionParameters.self)
+    combine(MM4TorsionExtendedParameters.self)
+    combine(SIMD2<UInt32>.self)
+    combine(SIMD3<UInt32>.self)
+    combine(SIMD4<UInt32>.self)
+    combine(SIMD8<UInt32>.self)
+    combine(SIMD4<Int32>.self)
+    hasher.combine(UInt32(1).littleEndian)
+    return hasher.value
+  }
+}
+
+// 64-bit FNV-1a, which is stable across processes (unlike `Hasher`).
+struct MM4ParametersHasher {
+  var value: UInt64 = 0xCBF2_9CE4_8422_2325
+  
+  @inline(__always)
+  mutating func combine(bytes: UnsafeRawBufferPointer) {
+    var value = self.value
+    for byte in bytes {
+      value ^= UInt64(byte)
+      value &*= 0x0000_0100_0000_01B3
+    }
+    self.value = value
+  }
+  
+  @inline(__always)
+  mutating func combine<T: FixedWidthInteger>(_ integer: T) {
+    withUnsafeBytes(of: integer.littleEndian) {
+      combine(bytes: $0)
+    }
+  }
+}
+
+struct MM4ParametersEncoder {
+  var data = Data()
+  
+  mutating func encode<T: FixedWidthInteger>(_ value: T) {
+    withUnsafeBytes(of: value.littleEndian) {
+      data.append(contentsOf: $0)
+    }
+  }
+  
+  mutating func encode(header: MM4ParametersHeader) {
+    encode(MM4ParametersHeader.magic)
+    encode(MM4ParametersHeader.version)
+    encode(MM4ParametersHeader.layoutFingerprint)
+    encode(header.key)
+    encode(header.forces)
+    encode(header.hydrogenMassScale)
+  }
+  
+  mutating func encode<T>(_ array: [T]) {
+    guard _isPOD(T.self) else {
+      fatalError("Cannot serialize a non-trivial type.")
+    }
+    encode(UInt64(array.count))
+    encode(UInt64(MemoryLayout<T>.stride))
+    array.withUnsafeBytes {
+      data.append(contentsOf: $0)
+    }
+    let padding = (8 - data.count % 8) % 8
+    data.append(contentsOf: repeatElement(UInt8(0), count: padding))
+  }
+  
+  // The payload of a missing element is zero.
+  mutating func encode<T>(optionals array: [T?]) {
+    encode(array.map { $0 == nil ? UInt8(0) : UInt8(1) })
+    let payloads = [T](unsafeUninitializedCapacity: array.count) {
+      buffer, initializedCount in
+      UnsafeMutableRawBufferPointer(buffer)
+        .initializeMemory(as: UInt8.self, repeating: 0)
+      for index in array.indices {
+        if let element = array[index] {
+          buffer[index] = element
+        }
+      }
+      initializedCount = array.count
+    }
+    encode(payloads)
+  }
+}
+
+struct MM4ParametersDecoder {
+  var data: Data
+  var cursor: Int = 0
+  var header = MM4ParametersHeader()
+  
+  // Set to false upon the first error, after which every array decodes as
+  // empty.
+  var valid: Bool = true
+  
+  init(data: Data) {
+    self.data = data
+  }
+  
+  mutating func decode<T: FixedWidthInteger>(_ type: T.Type) -> T {
+    guard valid, cursor + MemoryLayout<T>.size <= data.count else {
+      valid = false
+      return 0
+    }
+    let value = data.withUnsafeBytes {
+      $0.loadUnaligned(fromByteOffset: cursor, as: T.self)
+    }
+    cursor += MemoryLayout<T>.size
+    return T(littleEndian: value)
+  }
+  
+  mutating func decodeHeader() -> Bool {
+    guard decode(UInt32.self) == MM4ParametersHeader.magic,
+          decode(UInt32.self) == MM4ParametersHeader.version,
+          decode(UInt64.self) == MM4ParametersHeader.layoutFingerprint else {
+      return false
+    }
+    header.key = decode(UInt64.self)
+    header.forces = decode(UInt32.self)
+    header.hydrogenMassScale = decode(UInt32.self)
+    return valid
+  }
+  
+  mutating func decode<T>() -> [T] {
+    let count = Int(truncatingIfNeeded: decode(UInt64.self))
+    let stride = Int(truncatingIfNeeded: decode(UInt64.self))
+    guard valid,
+          stride == MemoryLayout<T>.stride,
+          count >= 0, count <= (data.count - cursor) / max(stride, 1) else {
+      valid = false
+      return []
+    }
+    
+    let byteCount = count * stride
+    let output = [T](unsafeUninitializedCapacity: count) {
+      buffer, initializedCount in
+      data.withUnsafeBytes {
+        let source = $0.baseAddress.unsafelyUnwrapped + cursor
+        let destination = UnsafeMutableRawPointer(buffer.baseAddress)
+        destination?.copyMemory(from: source, byteCount: byteCount)
+      }
+      initializedCount = count
+    }
+    cursor += byteCount
+    cursor += (8 - cursor % 8) % 8
+    cursor = min(cursor, data.count)
+    return output
+  }
+  
+  mutating func decodeOptionals<T>() -> [T?] {
+    let flags: [UInt8] = decode()
+    let payloads: [T] = decode()
+    guard valid, flags.count == payloads.count,
+          flags.allSatisfy({ $0 <= 1 }) else {
+      valid = false
+      return []
+    }
+    return zip(flags, payloads).map { flag, payload in
+      flag == 1 ? payload : nil
+    }
+  }
+  
+  // A raw value without a matching case invalidates the decoder.
+  mutating func decodeEnumerations<T: RawRepresentable>() -> [T]
+  where T.RawValue: FixedWidthInteger {
+    let rawValues: [T.RawValue] = decode()
+    let output = rawValues.compactMap(T.init(rawValue:))
+    guard valid, output.count == rawValues.count else {
+      valid = false
+      return []
+    }
+    return output
+  }
+  
+  mutating func decodeOptionalEnumerations<T: RawRepresentable>() -> [T?]
+  where T.RawValue: FixedWidthInteger {
+    let rawValues: [T.RawValue?] = decodeOptionals()
+    var output: [T?] = []
+    output.reserveCapacity(rawValues.count)
+    for rawValue in rawValues {
+      guard let rawValue else {
+        output.append(nil)
+        continue
+      }
+      guard let value = T(rawValue: rawValue) else {
+        valid = false
+        return []
+      }
+      output.append(value)
+    }
+    return output
+  }
+}
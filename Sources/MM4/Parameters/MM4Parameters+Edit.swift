@@ -0,0 +1,767 @@
+//
+//  MM4Parameters+Edit.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+/// A local change to the topology of a set of parameters.
+///
+/// The edited parameters use the same forces and hydrogen mass scale as the
+/// descriptor that created the original parameters. Parameters that combine
+/// structures with different settings cannot be edited.
+public struct MM4ParametersEdit {
+  /// The atoms to remove, as indices into the original parameters.
+  ///
+  /// Bonds to removed atoms are removed automatically. The remaining atoms
+  /// keep their relative order, but are shifted to fill the gaps left by the
+  /// removed atoms.
+  public var removedAtoms: [UInt32] = []
+  
+  /// The bonds to remove, as indices into the original parameters.
+  public var removedBonds: [SIMD2<UInt32>] = []
+  
+  /// The number of protons in each added atom's nucleus.
+  ///
+  /// Added atoms are placed after the remaining original atoms.
+  public var addedAtomicNumbers: [UInt8] = []
+  
+  /// The bonds to add, as indices into the edited parameters.
+  public var addedBonds: [SIMD2<UInt32>] = []
+  
+  public init() {
+    
+  }
+}
+
+extension MM4Parameters {
+  /// Check whether an edit produces a valid structure, without changing the
+  /// parameters.
+  ///
+  /// - throws: The error `init(descriptor:)` would throw for the edited
+  ///   structure. The addresses are indices into the edited structure.
+  ///
+  /// Only the atoms near the edit are parameterized, so the cost scales with
+  /// the size of the edit instead of the size of the structure.
+  public func validate(_ edit: MM4ParametersEdit) throws {
+    let graph = MM4ParametersEditGraph(base: self, edit: edit)
+    if try graph.createFragment() == nil {
+      _ = try MM4Parameters(descriptor: graph.createDescriptor())
+    }
+  }
+  
+  /// Change the topology, regenerating only the parameters near the edit.
+  ///
+  /// - throws: The error `init(descriptor:)` would throw for the edited
+  ///   structure. The parameters are unchanged when an error is thrown.
+  ///
+  /// The result matches `init(descriptor:)` for the edited structure, where
+  /// the bonds are the remaining original bonds followed by the added bonds.
+  /// Only the atoms near the edit are parameterized. Other parameters are
+  /// copied from the original, which is several orders of magnitude faster
+  /// than generating them.
+  public mutating func apply(_ edit: MM4ParametersEdit) throws {
+    let graph = MM4ParametersEditGraph(base: self, edit: edit)
+    if let fragment = try graph.createFragment() {
+      self = try MM4Parameters(graph: graph, fragment: fragment)
+    } else {
+      self = try MM4Parameters(descriptor: graph.createDescriptor())
+    }
+  }
+}
+
+// MARK: - Edited Topology
+
+/// The topology of the edited structure, computed lazily from the original
+/// parameters.
+struct MM4ParametersEditGraph {
+  // The number of bonds separating an atom from the farthest atom that can
+  // influence its parameters. The longest chain of dependencies is a partial
+  // charge, which depends on the equilibrium length of the bond to a neighbor
+  // (1), which depends on electronegativity corrections from atoms 2 bonds
+  // away from the bond (3), whose atom codes depend on membership in a
+  // 5-membered ring (5).
+  static let dependencyRadius: Int = 5
+  
+  // The number of bonds spanned by the largest group of atoms (a torsion).
+  static let groupSpan: Int = 3
+  
+  var base: MM4Parameters
+  var edit: MM4ParametersEdit
+  
+  // Sorted indices into the original parameters.
+  var removedAtoms: [UInt32]
+  
+  // Sorted pairs of indices into the original parameters.
+  var removedBonds: Set<SIMD2<UInt32>>
+  
+  var originalCount: Int
+  var editedCount: Int
+  
+  // Neighbors of every atom whose bonds changed, in edited indices.
+  var modifiedNeighbors: [UInt32: [UInt32]] = [:]
+  
+  init(base: MM4Parameters, edit: MM4ParametersEdit) {
+    guard base.forces != nil, base.hydrogenMassScale != nil else {
+      fatalError(
+        "Parameters with different forces or mass scales cannot be edited.")
+    }
+    self.base = base
+    self.edit = edit
+    self.originalCount = base.atoms.count
+    
+    removedAtoms = edit.removedAtoms.sorted()
+    for i in removedAtoms.indices {
+      guard removedAtoms[i] < originalCount else {
+        fatalError("Removed atom was out of range.")
+      }
+      if i > 0, removedAtoms[i] == removedAtoms[i - 1] {
+        fatalError("The same atom was removed twice.")
+      }
+    }
+    editedCount =
+    originalCount - removedAtoms.count + edit.addedAtomicNumbers.count
+    
+    removedBonds = []
+    for bond in edit.removedBonds {
+      let sortedBond = SIMD2(bond.min(), bond.max())
+      guard base.bonds.map[sortedBond] != nil else {
+        fatalError("Removed bond did not exist.")
+      }
+      guard removedBonds.insert(sortedBond).inserted else {
+        fatalError("The same bond was removed twice.")
+      }
+    }
+    
+    // Gather the atoms whose bonds changed.
+    var touchedAtoms: Set<UInt32> = []
+    for atomID in removedAtoms {
+      for neighborID in originalNeighbors(atomID) {
+        if let editedID = editedIndex(original: neighborID) {
+          touchedAtoms.insert(editedID)
+        }
+      }
+    }
+    for bond in removedBonds {
+      for lane in 0..<2 {
+        if let editedID = editedIndex(original: bond[lane]) {
+          touchedAtoms.insert(editedID)
+        }
+      }
+    }
+    let survivingCount = originalCount - removedAtoms.count
+    for atomID in survivingCount..<editedCount {
+      touchedAtoms.insert(UInt32(truncatingIfNeeded: atomID))
+    }
+    for bond in edit.addedBonds {
+      guard bond[0] != bond[1],
+            bond[0] < editedCount, bond[1] < editedCount else {
+        fatalError("Added bond was invalid.")
+      }
+      touchedAtoms.insert(bond[0])
+      touchedAtoms.insert(bond[1])
+    }
+    
+    // Regenerate the neighbor lists from the original bonds.
+    for editedID in touchedAtoms {
+      var neighbors: [UInt32] = []
+      if let originalID = originalIndex(edited: editedID) {
+        for neighborID in originalNeighbors(originalID) {
+          let bond = SIMD2(
+            min(originalID, neighborID), max(originalID, neighborID))
+          guard !removedBonds.contains(bond),
+                let editedNeighborID = editedIndex(original: neighborID) else {
+            continue
+          }
+          neighbors.append(editedNeighborID)
+        }
+      }
+      modifiedNeighbors[editedID] = neighbors
+    }
+    for bond in edit.addedBonds {
+      for lane in 0..<2 {
+        let atomID = bond[lane]
+        let otherID = bond[1 - lane]
+        guard !modifiedNeighbors[atomID]!.contains(otherID) else {
+          fatalError("The same bond was entered twice.")
+        }
+        modifiedNeighbors[atomID]!.append(otherID)
+      }
+    }
+  }
+  
+  func originalNeighbors(_ originalID: UInt32) -> [UInt32] {
+    let map = base.atomsToAtomsMap[Int(originalID)]
+    var output: [UInt32] = []
+    for lane in 0..<4 where map[lane] != -1 {
+      output.append(UInt32(truncatingIfNeeded: map[lane]))
+    }
+    return output
+  }
+  
+  // The number of removed atoms with an index less than or equal to the
+  // specified one.
+  func removedCount(through originalID: UInt32) -> Int {
+    var lowerBound = 0
+    var upperBound = removedAtoms.count
+    while lowerBound < upperBound {
+      let middle = (lowerBound + upperBound) / 2
+      if removedAtoms[middle] <= originalID {
+        lowerBound = middle + 1
+      } else {
+        upperBound = middle
+      }
+    }
+    return lowerBound
+  }
+  
+  func editedIndex(original originalID: UInt32) -> UInt32? {
+    let count = removedCount(through: originalID)
+    if count > 0, removedAtoms[count - 1] == originalID {
+      return nil
+    }
+    return originalID - UInt32(truncatingIfNeeded: count)
+  }
+  
+  func originalIndex(edited editedID: UInt32) -> UInt32? {
+    guard Int(editedID) < originalCount - removedAtoms.count else {
+      return nil
+    }
+    
+    // Iterate until the number of removed atoms before the candidate stops
+    // changing. This converges to the first surviving atom with the
+    // specified rank.
+    var originalID = editedID
+    while true {
+      let count = UInt32(truncatingIfNeeded: removedCount(through: originalID))
+      if editedID + count == originalID {
+        return originalID
+      }
+      originalID = editedID + count
+    }
+  }
+  
+  func atomicNumber(edited editedID: UInt32) -> UInt8 {
+    if let originalID = originalIndex(edited: editedID) {
+      return base.atoms.atomicNumbers[Int(originalID)]
+    } else {
+      let survivingCount = originalCount - removedAtoms.count
+      return edit.addedAtomicNumbers[Int(editedID) - survivingCount]
+    }
+  }
+  
+  func editedNeighbors(_ editedID: UInt32) -> [UInt32] {
+    if let neighbors = modifiedNeighbors[editedID] {
+      return neighbors
+    }
+    guard let originalID = originalIndex(edited: editedID) else {
+      fatalError("This should never happen.")
+    }
+    return originalNeighbors(originalID).map {
+      editedIndex(original: $0).unsafelyUnwrapped
+    }
+  }
+  
+  /// Breadth-first search over bonds, returning the distance to each atom
+  /// within the radius.
+  func expand(
+    _ sources: [UInt32],
+    radius: Int,
+    neighbors: (UInt32) -> [UInt32]
+  ) -> [UInt32: Int] {
+    var distances: [UInt32: Int] = [:]
+    var frontier: [UInt32] = []
+    for atomID in sources where distances[atomID] == nil {
+      distances[atomID] = 0
+      frontier.append(atomID)
+    }
+    for distance in 1...radius {
+      var nextFrontier: [UInt32] = []
+      for atomID in frontier {
+        for neighborID in neighbors(atomID)
+        where distances[neighborID] == nil {
+          distances[neighborID] = distance
+          nextFrontier.append(neighborID)
+        }
+      }
+      frontier = nextFrontier
+    }
+    return distances
+  }
+  
+  /// The descriptor for regenerating the edited structure from scratch.
+  func createDescriptor() -> MM4ParametersDescriptor {
+    var atomicNumbers: [UInt8] = []
+    atomicNumbers.reserveCapacity(editedCount)
+    for originalID in 0..<originalCount
+    where editedIndex(original: UInt32(originalID)) != nil {
+      atomicNumbers.append(base.atoms.atomicNumbers[originalID])
+    }
+    atomicNumbers += edit.addedAtomicNumbers
+    
+    var bonds: [SIMD2<UInt32>] = []
+    bonds.reserveCapacity(base.bonds.indices.count + edit.addedBonds.count)
+    for bond in base.bonds.indices where !removedBonds.contains(bond) {
+      guard let atom0 = editedIndex(original: bond[0]),
+            let atom1 = editedIndex(original: bond[1]) else {
+        continue
+      }
+      bonds.append(SIMD2(atom0, atom1))
+    }
+    bonds += edit.addedBonds
+    
+    var descriptor = MM4ParametersDescriptor()
+    descriptor.atomicNumbers = atomicNumbers
+    descriptor.bonds = bonds
+    descriptor.forces = base.forces!
+    descriptor.hydrogenMassScale = base.hydrogenMassScale!
+    return descriptor
+  }
+}
+
+// MARK: - Fragment
+
+/// Parameters for the neighborhood of an edit.
+struct MM4ParametersEditFragment {
+  var parameters: MM4Parameters
+  
+  // Map from fragment indices to edited indices. Capping atoms are not
+  // included; they come after every other atom in the fragment.
+  var editedIndices: [UInt32]
+  
+  // Map from edited indices to fragment indices.
+  var fragmentIndices: [UInt32: UInt32]
+  
+  // Atoms whose parameters may have changed, in edited indices.
+  var dirtyAtoms: Set<UInt32>
+}
+
+extension MM4ParametersEditGraph {
+  /// Parameterize the neighborhood of the edit.
+  ///
+  /// - throws: An error attributable to the edit.
+  /// - returns: `nil` if the fragment produced an error not attributable to
+  ///   the edit. This can happen when the atoms capping the fragment create an
+  ///   unsupported combination of elements. The caller must fall back to
+  ///   regenerating the entire structure.
+  func createFragment() throws -> MM4ParametersEditFragment? {
+    let seeds = modifiedNeighbors.keys.sorted()
+    
+    // Mark atoms within the dependency radius in either the original or the
+    // edited structure.
+    let radius = MM4ParametersEditGraph.dependencyRadius
+    var dirtyAtoms = Set(
+      expand(seeds, radius: radius, neighbors: editedNeighbors).keys)
+    var originalSeeds = removedAtoms
+    for editedID in seeds {
+      if let originalID = originalIndex(edited: editedID) {
+        originalSeeds.append(originalID)
+      }
+    }
+    let originalDistances = expand(
+      originalSeeds, radius: radius, neighbors: originalNeighbors)
+    for originalID in originalDistances.keys {
+      if let editedID = editedIndex(original: originalID) {
+        dirtyAtoms.insert(editedID)
+      }
+    }
+    
+    // Include every atom in a group with a dirty atom, and every atom that
+    // influences the group's parameters.
+    let fragmentRadius = MM4ParametersEditGraph.groupSpan + radius
+    let distances = expand(
+      Array(dirtyAtoms), radius: fragmentRadius, neighbors: editedNeighbors)
+    var fragmentAtoms = Set(distances.keys)
+    
+    // Only cut bonds to C, Si, and Ge. Other elements must be bonded to carbon,
+    // so this converges after one extra layer.
+    var frontier = fragmentAtoms.filter { distances[$0] == fragmentRadius }
+    while frontier.count > 0 {
+      var nextFrontier: Set<UInt32> = []
+      for atomID in frontier {
+        switch atomicNumber(edited: atomID) {
+        case 6, 14, 32:
+          continue
+        default:
+          break
+        }
+        for neighborID in editedNeighbors(atomID)
+        where !fragmentAtoms.contains(neighborID) {
+          fragmentAtoms.insert(neighborID)
+          nextFrontier.insert(neighborID)
+        }
+      }
+      frontier = nextFrontier
+    }
+    
+    // Assign fragment indices in the same order as edited indices, so groups
+    // are already sorted and oriented correctly after mapping.
+    let editedIndices = fragmentAtoms.sorted()
+    var fragmentIndices: [UInt32: UInt32] = [:]
+    fragmentIndices.reserveCapacity(editedIndices.count)
+    for (fragmentID, editedID) in editedIndices.enumerated() {
+      fragmentIndices[editedID] = UInt32(truncatingIfNeeded: fragmentID)
+    }
+    
+    var atomicNumbers = editedIndices.map(atomicNumber(edited:))
+    var bonds: [SIMD2<UInt32>] = []
+    func appendAtom(_ atomicNumber: UInt8) -> UInt32 {
+      atomicNumbers.append(atomicNumber)
+      return UInt32(truncatingIfNeeded: atomicNumbers.count - 1)
+    }
+    
+    // Cap each cut bond with hydrogen. Germanium does not support hydrogen,
+    // so it is capped with a methyl group instead.
+    for (fragmentID, editedID) in editedIndices.enumerated() {
+      let atomID = UInt32(truncatingIfNeeded: fragmentID)
+      for neighborID in editedNeighbors(editedID) {
+        if let otherID = fragmentIndices[neighborID] {
+          if atomID < otherID {
+            bonds.append(SIMD2(atomID, otherID))
+          }
+        } else if atomicNumbers[fragmentID] == 32 {
+          let carbonID = appendAtom(6)
+          bonds.append(SIMD2(atomID, carbonID))
+          for _ in 0..<3 {
+            bonds.append(SIMD2(carbonID, appendAtom(1)))
+          }
+        } else {
+          bonds.append(SIMD2(atomID, appendAtom(1)))
+        }
+      }
+    }
+    
+    var descriptor = MM4ParametersDescriptor()
+    descriptor.atomicNumbers = atomicNumbers
+    descriptor.bonds = bonds
+    descriptor.forces = base.forces!
+    descriptor.hydrogenMassScale = base.hydrogenMassScale!
+    
+    // Errors involving a dirty atom also occur in the edited structure.
+    // Translate their addresses from fragment indices to edited indices.
+    do {
+      let parameters = try MM4Parameters(descriptor: descriptor)
+      return MM4ParametersEditFragment(
+        parameters: parameters,
+        editedIndices: editedIndices,
+        fragmentIndices: fragmentIndices,
+        dirtyAtoms: dirtyAtoms)
+    } catch let error as MM4Error {
+      var attributable = false
+      var valid = true
+      func translate(_ address: MM4Address) -> MM4Address {
+        var output = address
+        guard Int(address.atomIndex) < editedIndices.count else {
+          valid = false
+          return output
+        }
+        output.atomIndex = editedIndices[Int(address.atomIndex)]
+        if dirtyAtoms.contains(output.atomIndex) {
+          attributable = true
+        }
+        return output
+      }
+      
+      let translated: MM4Error
+      switch error {
+      case .missingParameter(let addresses):
+        translated = .missingParameter(addresses.map(translate))
+      case .openValenceShell(let address, let addresses):
+        translated = .openValenceShell(
+          translate(address), addresses.map(translate))
+      case .unsupportedCenterType(let address, let addresses):
+        translated = .unsupportedCenterType(
+          translate(address), addresses.map(translate))
+      case .unsupportedRing(let addresses):
+        translated = .unsupportedRing(addresses.map(translate))
+      default:
+        throw error
+      }
+      guard attributable, valid else {
+        return nil
+      }
+      throw translated
+    }
+  }
+}
+
+// MARK: - Merging
+
+extension MM4Parameters {
+  /// Merge the parameters of the fragment into the original parameters.
+  init(
+    graph: MM4ParametersEditGraph,
+    fragment: MM4ParametersEditFragment
+  ) throws {
+    let base = graph.base
+    let local = fragment.parameters
+    forces = base.forces
+    hydrogenMassScale = base.hydrogenMassScale
+    
+    // Create dense maps between original and edited indices.
+    var editedIndices = [Int32](repeating: -1, count: graph.originalCount)
+    var originalIndices = [Int32](repeating: -1, count: graph.editedCount)
+    var removedCursor = 0
+    var editedCursor: Int32 = 0
+    for originalID in 0..<graph.originalCount {
+      if removedCursor < graph.removedAtoms.count,
+         graph.removedAtoms[removedCursor] == originalID {
+        removedCursor += 1
+        continue
+      }
+      editedIndices[originalID] = editedCursor
+      originalIndices[Int(editedCursor)] = Int32(truncatingIfNeeded: originalID)
+      editedCursor += 1
+    }
+    var dirtyMask = [Bool](repeating: false, count: graph.editedCount)
+    for atomID in fragment.dirtyAtoms {
+      dirtyMask[Int(atomID)] = true
+    }
+    
+    @inline(__always)
+    func fragmentIndex(_ editedID: UInt32) -> Int {
+      Int(fragment.fragmentIndices[editedID].unsafelyUnwrapped)
+    }
+    @inline(__always)
+    func mapOriginal<T: SIMD>(_ group: T) -> T?
+    where T.Scalar == UInt32 {
+      var output = group
+      for lane in 0..<T.scalarCount where group[lane] != .max {
+        let editedID = editedIndices[Int(group[lane])]
+        guard editedID != -1 else {
+          return nil
+        }
+        output[lane] = UInt32(truncatingIfNeeded: editedID)
+      }
+      return output
+    }
+    @inline(__always)
+    func mapFragment<T: SIMD>(_ group: T) -> T
+    where T.Scalar == UInt32 {
+      var output = group
+      for lane in 0..<T.scalarCount where group[lane] != .max {
+        guard Int(group[lane]) < fragment.editedIndices.count else {
+          fatalError("Capping atom was included in a dirty group.")
+        }
+        output[lane] = fragment.editedIndices[Int(group[lane])]
+      }
+      return output
+    }
+    @inline(__always)
+    func isDirty<T: SIMD>(_ group: T) -> Bool
+    where T.Scalar == UInt32 {
+      for lane in 0..<T.scalarCount where group[lane] != .max {
+        if dirtyMask[Int(group[lane])] {
+          return true
+        }
+      }
+      return false
+    }
+    
+    // Atoms
+    func gatherAtoms<T>(_ keyPath: KeyPath<MM4Atoms, [T]>) -> [T] {
+      let baseArray = base.atoms[keyPath: keyPath]
+      let localArray = local.atoms[keyPath: keyPath]
+      return (0..<graph.editedCount).map { atomID in
+        if dirtyMask[atomID] {
+          return localArray[fragmentIndex(UInt32(atomID))]
+        } else {
+          return baseArray[Int(originalIndices[atomID])]
+        }
+      }
+    }
+    atoms.atomicNumbers = gatherAtoms(\.atomicNumbers)
+    atoms.centerTypes = gatherAtoms(\.centerTypes)
+    atoms.codes = gatherAtoms(\.codes)
+    atoms.count = graph.editedCount
+    atoms.indices = 0..<graph.editedCount
+    atoms.masses = gatherAtoms(\.masses)
+    atoms.parameters = gatherAtoms(\.parameters)
+    atoms.ringTypes = gatherAtoms(\.ringTypes)
+    
+    // Bonds keep the order of the descriptor: remaining original bonds, then
+    // added bonds.
+    var bondSources: [Int] = []
+    bondSources.reserveCapacity(base.bonds.indices.count)
+    for (bondID, bond) in base.bonds.indices.enumerated()
+    where !graph.removedBonds.contains(bond) {
+      guard let editedBond = mapOriginal(bond) else {
+        continue
+      }
+      bonds.indices.append(editedBond)
+      if isDirty(editedBond) {
+        let localBond = SIMD2(
+          UInt32(fragmentIndex(editedBond[0])),
+          UInt32(fragmentIndex(editedBond[1])))
+        bondSources.append(~Int(local.bonds.map[localBond].unsafelyUnwrapped))
+      } else {
+        bondSources.append(bondID)
+      }
+    }
+    for bond in graph.edit.addedBonds {
+      let editedBond = SIMD2(bond.min(), bond.max())
+      let localBond = SIMD2(
+        UInt32(fragmentIndex(editedBond[0])),
+        UInt32(fragmentIndex(editedBond[1])))
+      bonds.indices.append(editedBond)
+      bondSources.append(~Int(local.bonds.map[localBond].unsafelyUnwrapped))
+    }
+    bonds.extendedParameters = MM4ParametersEditFragment.gather(
+      bondSources, base.bonds.extendedParameters,
+      local.bonds.extendedParameters)
+    bonds.parameters = MM4ParametersEditFragment.gather(
+      bondSources, base.bonds.parameters, local.bonds.parameters)
+    bonds.ringTypes = MM4ParametersEditFragment.gather(
+      bondSources, base.bonds.ringTypes, local.bonds.ringTypes)
+    
+    // Angles, torsions, and rings keep the order from `createTopology`.
+    // Unchanged original groups and dirty fragment groups are both sorted, so
+    // they can be merged in linear time.
+    func mergeGroups<T: SIMD>(
+      _ baseIndices: [T],
+      _ localIndices: [T],
+      by areInIncreasingOrder: (T, T) -> Bool
+    ) -> (indices: [T], sources: [Int]) where T.Scalar == UInt32 {
+      var baseGroups: [(T, Int)] = []
+      baseGroups.reserveCapacity(baseIndices.count)
+      for (groupID, group) in baseIndices.enumerated() {
+        if let editedGroup = mapOriginal(group), !isDirty(editedGroup) {
+          baseGroups.append((editedGroup, groupID))
+        }
+      }
+      var localGroups: [(T, Int)] = []
+      for (groupID, group) in localIndices.enumerated() {
+        let isCapped = (0..<T.scalarCount).contains { lane in
+          group[lane] != .max &&
+          Int(group[lane]) >= fragment.editedIndices.count
+        }
+        guard !isCapped else {
+          continue
+        }
+        let editedGroup = mapFragment(group)
+        if isDirty(editedGroup) {
+          localGroups.append((editedGroup, ~groupID))
+        }
+      }
+      
+      var indices: [T] = []
+      var sources: [Int] = []
+      indices.reserveCapacity(baseGroups.count + localGroups.count)
+      sources.reserveCapacity(baseGroups.count + localGroups.count)
+      var baseCursor = 0
+      var localCursor = 0
+      while baseCursor < baseGroups.count || localCursor < localGroups.count {
+        var element: (T, Int)
+        if localCursor == localGroups.count {
+          element = baseGroups[baseCursor]
+          baseCursor += 1
+        } else if baseCursor == baseGroups.count ||
+                    areInIncreasingOrder(
+                      localGroups[localCursor].0, baseGroups[baseCursor].0) {
+          element = localGroups[localCursor]
+          localCursor += 1
+        } else {
+          element = baseGroups[baseCursor]
+          baseCursor += 1
+        }
+        indices.append(element.0)
+        sources.append(element.1)
+      }
+      return (indices, sources)
+    }
+    
+    let angleMerge = mergeGroups(base.angles.indices, local.angles.indices) {
+      if $0[1] != $1[1] { return $0[1] < $1[1] }
+      if $0[0] != $1[0] { return $0[0] < $1[0] }
+      return $0[2] < $1[2]
+    }
+    angles.indices = angleMerge.indices
+    angles.extendedParameters = MM4ParametersEditFragment.gather(
+      angleMerge.sources, base.angles.extendedParameters,
+      local.angles.extendedParameters)
+    angles.parameters = MM4ParametersEditFragment.gather(
+      angleMerge.sources, base.angles.parameters, local.angles.parameters)
+    angles.ringTypes = MM4ParametersEditFragment.gather(
+      angleMerge.sources, base.angles.ringTypes, local.angles.ringTypes)
+    
+    let torsionMerge = mergeGroups(
+      base.torsions.indices, local.torsions.indices
+    ) {
+      if $0[1] != $1[1] { return $0[1] < $1[1] }
+      if $0[2] != $1[2] { return $0[2] < $1[2] }
+      if $0[0] != $1[0] { return $0[0] < $1[0] }
+      return $0[3] < $1[3]
+    }
+    torsions.indices = torsionMerge.indices
+    torsions.extendedParameters = MM4ParametersEditFragment.gather(
+      torsionMerge.sources, base.torsions.extendedParameters,
+      local.torsions.extendedParameters)
+    torsions.parameters = MM4ParametersEditFragment.gather(
+      torsionMerge.sources, base.torsions.parameters,
+      local.torsions.parameters)
+    torsions.ringTypes = MM4ParametersEditFragment.gather(
+      torsionMerge.sources, base.torsions.ringTypes, local.torsions.ringTypes)
+    
+    let ringMerge = mergeGroups(
+      base.rings.indices, local.rings.indices, by: base.compareRing)
+    rings.indices = ringMerge.indices
+    rings.ringTypes = MM4ParametersEditFragment.gather(
+      ringMerge.sources, base.rings.ringTypes, local.rings.ringTypes)
+    
+    // Nonbonded exceptions are unordered.
+    func mergeExceptions(
+      _ baseExceptions: [SIMD2<UInt32>],
+      _ localExceptions: [SIMD2<UInt32>]
+    ) -> [SIMD2<UInt32>] {
+      var output: [SIMD2<UInt32>] = []
+      output.reserveCapacity(baseExceptions.count)
+      for exception in baseExceptions {
+        if let editedException = mapOriginal(exception),
+           !isDirty(editedException) {
+          output.append(editedException)
+        }
+      }
+      for exception in localExceptions {
+        guard Int(exception.max()) < fragment.editedIndices.count else {
+          continue
+        }
+        let editedException = mapFragment(exception)
+        if isDirty(editedException) {
+          output.append(editedException)
+        }
+      }
+      return output
+    }
+    nonbondedExceptions13 = mergeExceptions(
+      base.nonbondedExceptions13, local.nonbondedExceptions13)
+    nonbondedExceptions14 = mergeExceptions(
+      base.nonbondedExceptions14, local.nonbondedExceptions14)
+    
+    // Regenerate the maps in the same order as `init(descriptor:)`.
+    try createAtomsToBondsMap()
+    try createAtomsToAtomsMap()
+    bonds.map = MM4GroupMap(bonds.indices)
+    angles.map = MM4GroupMap(angles.indices)
+    torsions.map = MM4GroupMap(torsions.indices)
+    rings.map = MM4GroupMap(rings.indices)
+  }
+}
+
+extension MM4ParametersEditFragment {
+  /// Select elements from the original parameters (non-negative sources) or
+  /// the fragment (bitwise complement of the fragment index).
+  static func gather<T>(
+    _ sources: [Int], _ baseArray: [T], _ localArray: [T]
+  ) -> [T] {
+    if baseArray.isEmpty && localArray.isEmpty {
+      return []
+    }
+    return sources.map { source in
+      if source >= 0 {
+        return baseArray[source]
+      } else {
+        return localArray[~source]
+      }
+    }
+  }
+}
@@ -0,0 +1,83 @@
+//
+//  MM4Parameters+Frequencies.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import Foundation
+
+extension MM4Parameters {
+  /// Estimate the highest angular frequency (in radians per picosecond) of
+  /// any bond stretch or angle bend.
+  ///
+  /// Each bond is treated as a harmonic oscillator with the curvature of the
+  /// Morse potential and the reduced mass of its atoms. Each angle uses the
+  /// Wilson G-matrix element for a bend, at the equilibrium geometry. The
+  /// masses are taken after hydrogen mass repartitioning, so a larger
+  /// `hydrogenMassScale` lowers the frequency.
+  ///
+  /// Returns zero if there are no bonds.
+  public func maximumVibrationalFrequency() -> Double {
+    // Units: millidyne / angstrom -> N / m
+    //            millidyne * angstrom -> J
+    //                       yoctogram -> kg
+    //                        angstrom -> m
+    let newtonsPerMeterPerStiffness: Double = 1e-8 / 1e-10
+    let joulesPerStiffness: Double = 1e-8 * 1e-10
+    let kilogramsPerYoctogram: Double = 1e-27
+    let metersPerAngstrom: Double = 1e-10
+    
+    var maximumSquared: Double = 0
+    for bondID in bonds.indices.indices {
+      let bond = bonds.indices[bondID]
+      let parameters = bonds.parameters[bondID]
+      let mass1 = Double(atoms.masses[Int(bond[0])])
+      let mass2 = Double(atoms.masses[Int(bond[1])])
+      guard mass1 > 0 || mass2 > 0 else {
+        continue
+      }
+      
+      // Anchors have infinite mass, so the other atom vibrates alone.
+      var inverseMass: Double = 0
+      for mass in [mass1, mass2] where mass > 0 {
+        inverseMass += 1 / (mass * kilogramsPerYoctogram)
+      }
+      let stiffness = Double(parameters.stretchingStiffness)
+      let omegaSquared = stiffness * newtonsPerMeterPerStiffness * inverseMass
+      maximumSquared = max(maximumSquared, omegaSquared)
+    }
+    
+    for angleID in angles.indices.indices {
+      let angle = angles.indices[angleID]
+      let parameters = angles.parameters[angleID]
+      guard let bondID1 = bonds.map[sortBond(SIMD2(angle[0], angle[1]))],
+            let bondID2 = bonds.map[sortBond(SIMD2(angle[1], angle[2]))] else {
+        fatalError("Invalid bond.")
+      }
+      let length1 = Double(bonds.parameters[Int(bondID1)].equilibriumLength)
+      let length2 = Double(bonds.parameters[Int(bondID2)].equilibriumLength)
+      let r1 = length1 * metersPerAngstrom
+      let r2 = length2 * metersPerAngstrom
+      let theta = Double(parameters.equilibriumAngle) * .pi / 180
+      
+      var inverseMasses: SIMD3<Double> = .zero
+      for lane in 0..<3 {
+        let mass = Double(atoms.masses[Int(angle[lane])])
+        if mass > 0 {
+          inverseMasses[lane] = 1 / (mass * kilogramsPerYoctogram)
+        }
+      }
+      var G = inverseMasses[0] / (r1 * r1) + inverseMasses[2] / (r2 * r2)
+      G += inverseMasses[1] * (
+        1 / (r1 * r1) + 1 / (r2 * r2) - 2 * cos(theta) / (r1 * r2))
+      
+      let stiffness = Double(parameters.bendingStiffness)
+      let omegaSquared = stiffness * joulesPerStiffness * G
+      maximumSquared = max(maximumSquared, omegaSquared)
+    }
+    
+    // Units: rad/s -> rad/ps
+    return maximumSquared.squareRoot() * 1e-12
+  }
+}
@@ -0,0 +1,136 @@
+//
+//  MM4Parameters+Map.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+/// Map from a group of atoms to the group's position in an array of indices.
+///
+/// The map shares storage with the array of indices, and only stores the
+/// permutation that sorts the groups. Groups are found with a binary search.
+/// When the groups are already sorted, such as rings, the permutation is
+/// omitted entirely.
+public struct MM4GroupMap<Key: SIMD>: Equatable where Key.Scalar == UInt32 {
+  // The groups, in the same order as the array of indices.
+  var keys: [Key]
+  
+  // Positions in `keys`, in lexicographic order of the groups. Empty if the
+  // keys are already in lexicographic order.
+  var order: [UInt32]
+  
+  /// Create an empty map.
+  public init() {
+    self.keys = []
+    self.order = []
+  }
+  
+  /// Create a map from each group to its position in the array.
+  ///
+  /// The groups must be unique.
+  public init(_ keys: [Key]) {
+    self.keys = keys
+    self.order = []
+    guard keys.count > 1 else {
+      return
+    }
+    
+    var sorted = true
+    for i in 1..<keys.count where !Self.compare(keys[i - 1], keys[i]) {
+      sorted = false
+      break
+    }
+    if !sorted {
+      order = (0..<UInt32(truncatingIfNeeded: keys.count)).map { $0 }
+      order.sort { Self.compare(keys[Int($0)], keys[Int($1)]) }
+    }
+  }
+  
+  public static func == (lhs: Self, rhs: Self) -> Bool {
+    lhs.keys == rhs.keys
+  }
+  
+  /// The number of groups in the map.
+  public var count: Int {
+    keys.count
+  }
+  
+  /// The position of the group, or `nil` if the group is not present.
+  @inline(__always)
+  public subscript(key: Key) -> UInt32? {
+    var lowerBound = 0
+    var upperBound = keys.count
+    if order.isEmpty {
+      while lowerBound < upperBound {
+        let middle = (lowerBound + upperBound) / 2
+        if Self.compare(keys[middle], key) {
+          lowerBound = middle + 1
+        } else {
+          upperBound = middle
+        }
+      }
+      guard lowerBound < keys.count, keys[lowerBound] == key else {
+        return nil
+      }
+      return UInt32(truncatingIfNeeded: lowerBound)
+    } else {
+      while lowerBound < upperBound {
+        let middle = (lowerBound + upperBound) / 2
+        if Self.compare(keys[Int(order[middle])], key) {
+          lowerBound = middle + 1
+        } else {
+          upperBound = middle
+        }
+      }
+      guard lowerBound < order.count,
+            keys[Int(order[lowerBound])] == key else {
+        return nil
+      }
+      return order[lowerBound]
+    }
+  }
+}
+
+extension MM4GroupMap {
+  /// Lexicographic order, where unused lanes (`UInt32.max`) sort last.
+  @inline(__always)
+  static func compare(_ lhs: Key, _ rhs: Key) -> Bool {
+    for lane in 0..<Key.scalarCount where lhs[lane] != rhs[lane] {
+      return lhs[lane] < rhs[lane]
+    }
+    return false
+  }
+  
+  /// Append groups whose atoms all have larger indices than the existing
+  /// groups, without sorting them again.
+  ///
+  /// The keys must be the existing groups followed by the other map's groups,
+  /// after offsetting their atom indices. Before appending to the array of
+  /// indices, remove the map's keys to prevent the array from being copied.
+  mutating func append(contentsOf other: Self, keys: [Key]) {
+    guard keys.count >= other.keys.count else {
+      fatalError("Keys did not match the appended groups.")
+    }
+    let offset = UInt32(truncatingIfNeeded: keys.count - other.keys.count)
+    guard order.isEmpty || order.count == Int(offset) else {
+      fatalError("Keys did not match the existing groups.")
+    }
+    
+    // Groups from the other map begin with a larger atom index, so they sort
+    // after every existing group.
+    if !order.isEmpty || !other.order.isEmpty {
+      if order.isEmpty {
+        order = (0..<offset).map { $0 }
+      }
+      order.reserveCapacity(keys.count)
+      if other.order.isEmpty {
+        order += (0..<UInt32(truncatingIfNeeded: other.keys.count)).map {
+          $0 &+ offset
+        }
+      } else {
+        order += other.order.map { $0 &+ offset }
+      }
+    }
+    self.keys = keys
+  }
+}
@@ -16,29 +16,23 @@ public struct MM4Rings {
   public var indices: [SIMD8<UInt32>] = []
   
   /// Map from a group of atoms to a ring index.
-  public var map: [SIMD8<UInt32>: UInt32] = [:]
+  public var map: MM4GroupMap<SIMD8<UInt32>> = MM4GroupMap()
   
   /// The number of atoms in the ring.
   public var ringTypes: [UInt8] = []
   
   mutating func append(contentsOf other: Self, atomOffset: UInt32) {
-    let ringOffset = UInt32(self.indices.count)
+    self.map.keys = []
     self.indices += other.indices.map {
       let modified = $0 &+ atomOffset
       return $0.replacing(with: modified, where: $0 .< UInt32.max)
     }
-    for var key in other.map.keys {
-      let value = other.map[key].unsafelyUnwrapped
-      let modifiedKey = key &+ atomOffset
-      key.replace(with: modifiedKey, where: key .< UInt32.max)
-      self.map[key] = value &+ ringOffset
-    }
+    self.map.append(contentsOf: other.map, keys: self.indices)
     self.ringTypes += other.ringTypes
   }
   
   mutating func reserveCapacity(_ minimumCapacity: Int) {
     indices.reserveCapacity(minimumCapacity)
-    map.reserveCapacity(minimumCapacity)
     ringTypes.reserveCapacity(minimumCapacity)
   }
 }
@@ -50,11 +44,7 @@ extension MM4Parameters {
       repeating: SIMD4(repeating: -1), count: atoms.count)
     
     for bondID in 0..<bonds.indices.count {
-      // Initialize the bonds map, so it can be used later when generating the
-      // topology of angles/torsions/rings.
       let bond = bonds.indices[bondID]
-      bonds.map[bond] = .max
-      
       for j in 0..<2 {
         let atomID = Int(bond[j])
         var map = atomsToBondsMap[atomID]
@@ -387,18 +377,10 @@ extension MM4Parameters {
           rings.indices.count < Int32.max else {
       fatalError("Too many bonds, angles, torsions, or rings.")
     }
-    for (index, angle) in bonds.indices.enumerated() {
-      bonds.map[angle] = UInt32(truncatingIfNeeded: index)
-    }
-    for (index, angle) in angles.indices.enumerated() {
-      angles.map[angle] = UInt32(truncatingIfNeeded: index)
-    }
-    for (index, torsion) in torsions.indices.enumerated() {
-      torsions.map[torsion] = UInt32(truncatingIfNeeded: index)
-    }
-    for (index, ring) in rings.indices.enumerated() {
-      rings.map[ring] = UInt32(truncatingIfNeeded: index)
-    }
+    bonds.map = MM4GroupMap(bonds.indices)
+    angles.map = MM4GroupMap(angles.indices)
+    torsions.map = MM4GroupMap(torsions.indices)
+    rings.map = MM4GroupMap(rings.indices)
     
     for ringID in rings.indices.indices {
       let ring = rings.indices[ringID]
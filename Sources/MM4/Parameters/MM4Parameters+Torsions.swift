@@ -14,7 +14,7 @@ public struct MM4Torsions {
   public var indices: [SIMD4<UInt32>] = []
   
   /// Map from a group of atoms to a torsion index.
-  public var map: [SIMD4<UInt32>: UInt32] = [:]
+  public var map: MM4GroupMap<SIMD4<UInt32>> = MM4GroupMap()
   
   /// Each value corresponds to the torsion at the same array index.
   public var parameters: [MM4TorsionParameters] = []
@@ -23,15 +23,12 @@ public struct MM4Torsions {
   public var ringTypes: [UInt8] = []
   
   mutating func append(contentsOf other: Self, atomOffset: UInt32) {
-    let torsionOffset = UInt32(self.indices.count)
     self.extendedParameters += other.extendedParameters
+    self.map.keys = []
     self.indices += other.indices.map {
       $0 &+ atomOffset
     }
-    for key in other.map.keys {
-      let value = other.map[key].unsafelyUnwrapped
-      self.map[key &+ atomOffset] = value &+ torsionOffset
-    }
+    self.map.append(contentsOf: other.map, keys: self.indices)
     self.parameters += other.parameters
     self.ringTypes += other.ringTypes
   }
@@ -39,7 +36,6 @@ public struct MM4Torsions {
   mutating func reserveCapacity(_ minimumCapacity: Int) {
     extendedParameters.reserveCapacity(minimumCapacity)
     indices.reserveCapacity(minimumCapacity)
-    map.reserveCapacity(minimumCapacity)
     parameters.reserveCapacity(minimumCapacity)
     ringTypes.reserveCapacity(minimumCapacity)
   }
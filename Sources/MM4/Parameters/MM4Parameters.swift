@@ -11,6 +11,15 @@ public struct MM4ParametersDescriptor {
   public var atomicNumbers: [UInt8]?
   
   /// Required. Pairs of atom indices representing sigma bonds.
+  ///
+  /// The parameters only depend on the connectivity, not the positions. In a
+  /// periodic cell, bond each atom to the nearest image of its neighbor. Rings
+  /// that cross the boundary are parameterized normally. Only cycles in the
+  /// topology that wrap around the entire cell are a problem, as a short one
+  /// would be mistaken for a ring. The cell must be at least
+  /// `2 × cutoffDistance` wide along each axis (see
+  /// `MM4ForceFieldDescriptor.boxVectors`), which makes every such cycle far
+  /// longer than the largest ring MM4 detects.
   public var bonds: [SIMD2<UInt32>]?
   
   /// Required. The forces to assign parameters for.
@@ -76,6 +85,14 @@ public struct MM4Parameters {
   /// Map from atoms to connected atoms that requires bounds checking.
   var atomsToAtomsMap: [SIMD4<Int32>] = []
   
+  /// The forces from the descriptor. `nil` if the parameters combine
+  /// structures created with different forces.
+  var forces: MM4ForceOptions?
+  
+  /// The hydrogen mass scale from the descriptor. `nil` if the parameters
+  /// combine structures created with different scales.
+  var hydrogenMassScale: Float?
+  
   /// Create a set of parameters using the specified configuration.
   ///
   /// - throws: An error if there wasn't a parameter for a certain atom pair, or
@@ -100,6 +117,8 @@ public struct MM4Parameters {
     bonds.indices = descriptorBonds.map { bond in
       return SIMD2(bond.min(), bond.max())
     }
+    forces = descriptor.forces
+    hydrogenMassScale = descriptor.hydrogenMassScale
     
     // Topology
     try createAtomsToBondsMap()
@@ -144,5 +163,11 @@ public struct MM4Parameters {
       let modified = $0 &+ Int32(truncatingIfNeeded: atomOffset)
       return $0.replacing(with: modified, where: $0 .>= 0)
     }
+    if forces != other.forces {
+      forces = nil
+    }
+    if hydrogenMassScale != other.hydrogenMassScale {
+      hydrogenMassScale = nil
+    }
   }
 }
@@ -44,6 +44,24 @@ extension MM4RigidBody {
   public mutating func setThermalKineticEnergy(
     temperature: Float,
     heatCapacity: Float = 1.5
+  ) {
+    var generator = SystemRandomNumberGenerator()
+    setThermalKineticEnergy(
+      temperature: temperature,
+      heatCapacity: heatCapacity,
+      using: &generator)
+  }
+  
+  /// Set the thermal kinetic energy to match a given temperature, using the
+  /// specified source of randomness.
+  ///
+  /// A seeded generator reproduces the same velocities for the same rigid
+  /// body. Independent replicas of a simulation should use generators with
+  /// different seeds.
+  public mutating func setThermalKineticEnergy<T: RandomNumberGenerator>(
+    temperature: Float,
+    heatCapacity: Float = 1.5,
+    using generator: inout T
   ) {
     // Change the thermal velocities regardless of whether the previous thermal
     // energy was the same as the new value. This design choice reduces the
@@ -61,12 +79,15 @@ extension MM4RigidBody {
     
     let kT = Float(MM4BoltzInZJPerK) * temperature
     let particleEnergy = heatCapacity * kT
-    storage.createThermalVelocities(particleEnergy: particleEnergy)
+    storage.createThermalVelocities(
+      particleEnergy: particleEnergy, generator: &generator)
   }
 }
 
 extension MM4RigidBodyStorage {
-  func createThermalVelocities(particleEnergy: Float) {
+  func createThermalVelocities<T: RandomNumberGenerator>(
+    particleEnergy: Float, generator: inout T
+  ) {
     ensureCenterOfMassCached()
     ensureLinearVelocityCached()
     ensureAngularVelocityCached()
@@ -142,7 +163,6 @@ extension MM4RigidBodyStorage {
     
     // Repeatedly compact the list, removing pairs that failed.
     var scalarsFinished = 0
-    var generator = SystemRandomNumberGenerator()
     while scalarsFinished < scalarsRequired {
       // Round down to UInt64 alignment.
       scalarsFinished = scalarsFinished / 4 * 4
@@ -0,0 +1,96 @@
+//
+//  MM4TrajectoryFormat.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+// Layout of the binary trajectory format. All integers are little-endian.
+//
+// Header (32 bytes)
+// - magic number (UInt32)
+// - version (UInt32)
+// - atom count (UInt32)
+// - keyframe interval (UInt32)
+// - resolution, in nanometers (Double)
+// - reserved (UInt64)
+//
+// Frames
+// - time, in picoseconds (Double)
+// - three coordinates per atom, as zigzag-encoded variable-length integers.
+//   Keyframes store each coordinate relative to the previous atom. Other
+//   frames store each coordinate relative to the same atom in the previous
+//   frame.
+//
+// Index
+// - byte offset of each frame (UInt64)
+// - frame count (UInt64)
+// - byte offset of the index (UInt64)
+//
+// Atoms are stored in their original order, which is independent of the
+// particle order inside OpenMM.
+enum MM4TrajectoryFormat {
+  // The bytes "MM4T".
+  static let magic: UInt32 = 0x5434_4D4D
+  static let version: UInt32 = 1
+  static let headerSize: Int = 32
+  static let trailerSize: Int = 16
+  
+  // One atom takes up to 15 bytes: three varints of up to 5 bytes each.
+  static let maxAtomSize: Int = 15
+  
+  @_transparent
+  static func quantize(
+    _ position: SIMD3<Float>, resolution: Double
+  ) -> SIMD3<Int32> {
+    var scaled = SIMD3<Double>(position) / resolution
+    scaled.round(.toNearestOrEven)
+    let bound = Double(Int32.max)
+    guard all(scaled .>= -bound), all(scaled .<= bound) else {
+      fatalError("Position exceeded the range of the trajectory format.")
+    }
+    return SIMD3<Int32>(scaled)
+  }
+  
+  @_transparent
+  static func dequantize(
+    _ position: SIMD3<Int32>, resolution: Double
+  ) -> SIMD3<Float> {
+    SIMD3<Float>(SIMD3<Double>(position) * resolution)
+  }
+  
+  // Wrapping arithmetic allows any delta between two 32-bit integers to
+  // round-trip exactly.
+  @inline(__always)
+  static func encode(_ value: Int32, to buffer: inout [UInt8]) {
+    var zigzag = UInt32(bitPattern: (value &<< 1) ^ (value &>> 31))
+    while zigzag >= 0x80 {
+      buffer.append(UInt8(truncatingIfNeeded: zigzag) | 0x80)
+      zigzag &>>= 7
+    }
+    buffer.append(UInt8(truncatingIfNeeded: zigzag))
+  }
+  
+  // Returns `nil` if the varint runs past the end of the frame, or is longer
+  // than five bytes.
+  @inline(__always)
+  static func decode(
+    _ bytes: UnsafeRawBufferPointer, cursor: inout Int, end: Int
+  ) -> Int32? {
+    var zigzag: UInt32 = 0
+    var shift: UInt32 = 0
+    while true {
+      guard cursor < end, shift < 35 else {
+        return nil
+      }
+      let byte = bytes[cursor]
+      cursor += 1
+      zigzag |= UInt32(byte & 0x7F) &<< shift
+      shift += 7
+      if byte < 0x80 {
+        break
+      }
+    }
+    return Int32(bitPattern: zigzag &>> 1) ^ -Int32(bitPattern: zigzag & 1)
+  }
+}
@@ -0,0 +1,164 @@
+//
+//  MM4TrajectoryReader.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import Foundation
+
+/// Reads frames from a trajectory file created by ``MM4TrajectoryWriter``.
+///
+/// The file is memory-mapped, so opening it does not read the frames. Reading
+/// frames in ascending order decodes each frame once. Reading a random frame
+/// decodes, at most, every frame since the previous keyframe.
+public class MM4TrajectoryReader {
+  let url: URL
+  let data: Data
+  let keyframeInterval: Int
+  let resolution: Double
+  let indexOffset: Int
+  
+  // The most recently decoded frame, in fixed-point.
+  var cachedFrameID: Int = -1
+  var cachedPositions: [SIMD3<Int32>]
+  
+  /// The number of atoms in every frame.
+  public let atomCount: Int
+  
+  /// The number of frames in the trajectory.
+  public let frameCount: Int
+  
+  /// Open a trajectory file.
+  ///
+  /// Throws ``MM4Error/invalidFileFormat(_:)`` if the file is not a complete
+  /// trajectory. For example, the writer may not have been closed.
+  public init(url: URL) throws {
+    let data = try Data(contentsOf: url, options: .alwaysMapped)
+    self.url = url
+    self.data = data
+    guard data.count >=
+            MM4TrajectoryFormat.headerSize + MM4TrajectoryFormat.trailerSize
+    else {
+      throw MM4Error.invalidFileFormat(url)
+    }
+    
+    func load<T: FixedWidthInteger>(_ offset: Int, as type: T.Type) -> T {
+      data.withUnsafeBytes {
+        T(littleEndian: $0.loadUnaligned(fromByteOffset: offset, as: T.self))
+      }
+    }
+    guard load(0, as: UInt32.self) == MM4TrajectoryFormat.magic,
+          load(4, as: UInt32.self) == MM4TrajectoryFormat.version else {
+      throw MM4Error.invalidFileFormat(url)
+    }
+    atomCount = Int(load(8, as: UInt32.self))
+    keyframeInterval = Int(load(12, as: UInt32.self))
+    resolution = Double(bitPattern: load(16, as: UInt64.self))
+    cachedPositions = Array(repeating: .zero, count: atomCount)
+    
+    // Validate the index, so frames can be read without checking offsets.
+    let trailerOffset = data.count - MM4TrajectoryFormat.trailerSize
+    let frameCount64 = load(trailerOffset, as: UInt64.self)
+    let indexOffset64 = load(trailerOffset + 8, as: UInt64.self)
+    guard keyframeInterval > 0,
+          resolution > 0,
+          frameCount64 <= UInt64(trailerOffset / 8),
+          indexOffset64 == UInt64(trailerOffset) - 8 * frameCount64 else {
+      throw MM4Error.invalidFileFormat(url)
+    }
+    frameCount = Int(frameCount64)
+    indexOffset = Int(indexOffset64)
+    
+    var previousOffset = MM4TrajectoryFormat.headerSize
+    for frameID in 0..<frameCount {
+      let frameOffset = Int(load(indexOffset + 8 * frameID, as: UInt64.self))
+      guard frameOffset >= previousOffset,
+            frameOffset + 8 <= indexOffset else {
+        throw MM4Error.invalidFileFormat(url)
+      }
+      previousOffset = frameOffset + 8
+    }
+  }
+  
+  /// The time of a frame, in picoseconds.
+  public func time(frame frameID: Int) -> Double {
+    let frameOffset = offset(frame: frameID)
+    return data.withUnsafeBytes {
+      let bitPattern = $0.loadUnaligned(
+        fromByteOffset: frameOffset, as: UInt64.self)
+      return Double(bitPattern: UInt64(littleEndian: bitPattern))
+    }
+  }
+  
+  /// The position (in nanometers) of each atom in a frame, in the original
+  /// order.
+  ///
+  /// Throws ``MM4Error/invalidFileFormat(_:)`` if the frame's data was
+  /// corrupted.
+  public func positions(frame frameID: Int) throws -> [SIMD3<Float>] {
+    try decode(frame: frameID)
+    return cachedPositions.map {
+      MM4TrajectoryFormat.dequantize($0, resolution: resolution)
+    }
+  }
+}
+
+extension MM4TrajectoryReader {
+  func offset(frame frameID: Int) -> Int {
+    guard frameID >= 0, frameID < frameCount else {
+      fatalError("Frame index was out of range.")
+    }
+    return data.withUnsafeBytes {
+      let offset = $0.loadUnaligned(
+        fromByteOffset: indexOffset + 8 * frameID, as: UInt64.self)
+      return Int(UInt64(littleEndian: offset))
+    }
+  }
+  
+  func decode(frame frameID: Int) throws {
+    let keyframeID = frameID - frameID % keyframeInterval
+    var startID = keyframeID
+    if cachedFrameID >= keyframeID, cachedFrameID <= frameID {
+      startID = cachedFrameID + 1
+    }
+    guard startID <= frameID else {
+      return
+    }
+    
+    // The cache is partially overwritten if decoding fails.
+    cachedFrameID = -1
+    try data.withUnsafeBytes { bytes in
+      for currentID in startID...frameID {
+        var cursor = offset(frame: currentID) + 8
+        var end = indexOffset
+        if currentID + 1 < frameCount {
+          end = offset(frame: currentID + 1)
+        }
+        
+        let keyframe = currentID == keyframeID
+        var reference: SIMD3<Int32> = .zero
+        for atomID in 0..<atomCount {
+          if !keyframe {
+            reference = cachedPositions[atomID]
+          }
+          var delta: SIMD3<Int32> = .zero
+          for laneID in 0..<3 {
+            guard let value = MM4TrajectoryFormat.decode(
+              bytes, cursor: &cursor, end: end) else {
+              throw MM4Error.invalidFileFormat(url)
+            }
+            delta[laneID] = value
+          }
+          
+          let current = reference &+ delta
+          cachedPositions[atomID] = current
+          if keyframe {
+            reference = current
+          }
+        }
+      }
+    }
+    cachedFrameID = frameID
+  }
+}
@@ -0,0 +1,186 @@
+//
+//  MM4TrajectoryWriter.swift
+//  MM4
+//
+//  Created by agent on 10/16/26.
+//
+
+import Foundation
+
+/// A configuration for a trajectory writer.
+public struct MM4TrajectoryWriterDescriptor {
+  /// Required. The number of atoms in every frame.
+  public var atomCount: Int?
+  
+  /// Required. The number of frames between consecutive keyframes.
+  ///
+  /// Keyframes can be decoded on their own, but take more space than other
+  /// frames. Reading a random frame requires decoding every frame since the
+  /// last keyframe.
+  ///
+  /// The default is 32.
+  public var keyframeInterval: Int = 32
+  
+  /// Required. The spacing of the fixed-point grid that positions are rounded
+  /// to, in nanometers.
+  ///
+  /// The default is 0.0001 nm (0.1 pm).
+  public var resolution: Double = 0.0001
+  
+  /// Required. The location of the file. Any existing file is overwritten.
+  public var url: URL?
+  
+  public init() {
+    
+  }
+}
+
+/// Streams positions to a compact binary trajectory file.
+///
+/// Positions are quantized to fixed-point integers and delta-encoded, either
+/// against the previous atom (keyframes) or the previous frame (everything
+/// else). An index of frame offsets is written when the file is closed, which
+/// allows ``MM4TrajectoryReader`` to reach any frame by random access.
+public class MM4TrajectoryWriter {
+  var descriptor: MM4TrajectoryWriterDescriptor
+  var fileHandle: FileHandle?
+  
+  // Reused between frames to avoid allocation.
+  var buffer: [UInt8] = []
+  var previousPositions: [SIMD3<Int32>]
+  
+  var frameOffsets: [UInt64] = []
+  var byteCount: UInt64 = 0
+  
+  /// Create a trajectory writer and write the file's header.
+  public init(descriptor: MM4TrajectoryWriterDescriptor) throws {
+    guard let atomCount = descriptor.atomCount,
+          let url = descriptor.url else {
+      fatalError("Descriptor did not have the required properties.")
+    }
+    guard atomCount >= 0, atomCount <= Int(UInt32.max),
+          descriptor.keyframeInterval > 0,
+          descriptor.keyframeInterval <= Int(UInt32.max),
+          descriptor.resolution > 0 else {
+      fatalError("Descriptor had invalid properties.")
+    }
+    self.descriptor = descriptor
+    self.previousPositions = Array(repeating: .zero, count: atomCount)
+    
+    FileManager.default.createFile(atPath: url.path, contents: nil)
+    self.fileHandle = try FileHandle(forWritingTo: url)
+    
+    buffer.reserveCapacity(
+      MM4TrajectoryFormat.headerSize +
+      MM4TrajectoryFormat.maxAtomSize * atomCount + 8)
+    append(MM4TrajectoryFormat.magic)
+    append(MM4TrajectoryFormat.version)
+    append(UInt32(atomCount))
+    append(UInt32(descriptor.keyframeInterval))
+    append(descriptor.resolution.bitPattern)
+    append(UInt64(0))
+    try flushBuffer()
+  }
+  
+  deinit {
+    try? close()
+  }
+  
+  /// The number of frames written so far.
+  public var frameCount: Int {
+    frameOffsets.count
+  }
+  
+  /// Append a frame to the trajectory.
+  ///
+  /// - Parameter positions: The position (in nanometers) of each atom, in the
+  ///   original order.
+  /// - Parameter time: The time of the frame, in picoseconds.
+  /// - Throws: The error from the file system, if the frame could not be
+  ///   written.
+  public func write(positions: [SIMD3<Float>], time: Double) throws {
+    guard fileHandle != nil else {
+      fatalError("Trajectory writer was already closed.")
+    }
+    guard positions.count == previousPositions.count else {
+      fatalError("Position buffer was not the correct size.")
+    }
+    let keyframe = frameOffsets.count % descriptor.keyframeInterval == 0
+    frameOffsets.append(byteCount)
+    append(time.bitPattern)
+    
+    let resolution = descriptor.resolution
+    var reference: SIMD3<Int32> = .zero
+    for atomID in positions.indices {
+      let current = MM4TrajectoryFormat.quantize(
+        positions[atomID], resolution: resolution)
+      if !keyframe {
+        reference = previousPositions[atomID]
+      }
+      let delta = current &- reference
+      MM4TrajectoryFormat.encode(delta.x, to: &buffer)
+      MM4TrajectoryFormat.encode(delta.y, to: &buffer)
+      MM4TrajectoryFormat.encode(delta.z, to: &buffer)
+      
+      previousPositions[atomID] = current
+      if keyframe {
+        reference = current
+      }
+    }
+    try flushBuffer()
+  }
+  
+  /// Append a frame captured by a trajectory recorder.
+  ///
+  /// The recorder must be configured to report positions.
+  public func write(_ frame: MM4TrajectoryFrame) throws {
+    guard let positions = frame.positions else {
+      fatalError("Frame did not contain positions.")
+    }
+    try write(positions: positions, time: frame.time)
+  }
+  
+  /// Write the index of frame offsets and close the file.
+  ///
+  /// This is called automatically when the writer is deallocated, but any
+  /// error is then ignored. Frames cannot be written after the file is
+  /// closed.
+  public func close() throws {
+    guard let fileHandle else {
+      return
+    }
+    defer {
+      fileHandle.closeFile()
+      self.fileHandle = nil
+    }
+    let indexOffset = byteCount
+    for frameOffset in frameOffsets {
+      append(frameOffset)
+    }
+    append(UInt64(frameOffsets.count))
+    append(indexOffset)
+    try flushBuffer()
+  }
+}
+
+extension MM4TrajectoryWriter {
+  @inline(__always)
+  func append<T: FixedWidthInteger>(_ value: T) {
+    withUnsafeBytes(of: value.littleEndian) {
+      buffer.append(contentsOf: $0)
+    }
+  }
+  
+  func flushBuffer() throws {
+    guard buffer.count > 0 else {
+      return
+    }
+    try buffer.withUnsafeMutableBytes {
+      let data = Data(
+        bytesNoCopy: $0.baseAddress!, count: $0.count, deallocator: .none)
+      try fileHandle!.write(contentsOf: data)
+    }
+    byteCount += UInt64(buffer.count)
+    buffer.removeAll(keepingCapacity: true)
+  }
+}
@@ -15,6 +15,196 @@ final class MM4ParametersTests: XCTestCase {
     try testAdamantaneVariant(atomCode: .alkaneCarbon)
   }
   
+  func testCache() throws {
+    let cacheDirectory = FileManager.default.temporaryDirectory
+      .appendingPathComponent("MM4ParametersTests-\(UUID().uuidString)")
+    defer {
+      try? FileManager.default.removeItem(at: cacheDirectory)
+    }
+    
+    let adamantane = Adamantane(atomCode: .silicon)
+    var paramsDesc = MM4ParametersDescriptor()
+    paramsDesc.atomicNumbers = adamantane.atomicNumbers
+    paramsDesc.bonds = adamantane.bonds
+    let reference = try MM4Parameters(descriptor: paramsDesc)
+    
+    // The first call populates the cache, the second reads from it.
+    _ = try MM4Parameters(
+      descriptor: paramsDesc, cacheDirectory: cacheDirectory)
+    let entries = try FileManager.default.contentsOfDirectory(
+      at: cacheDirectory, includingPropertiesForKeys: nil)
+    XCTAssertEqual(entries.count, 1)
+    let params = try MM4Parameters(
+      descriptor: paramsDesc, cacheDirectory: cacheDirectory)
+    
+    XCTAssertEqual(reference.atoms.atomicNumbers, params.atoms.atomicNumbers)
+    XCTAssertEqual(reference.atoms.codes, params.atoms.codes)
+    XCTAssertEqual(reference.atoms.masses, params.atoms.masses)
+    XCTAssertEqual(reference.atoms.ringTypes, params.atoms.ringTypes)
+    XCTAssertEqual(reference.bonds.indices, params.bonds.indices)
+    XCTAssertEqual(reference.bonds.map, params.bonds.map)
+    XCTAssertEqual(
+      reference.bonds.parameters.map(\.stretchingStiffness),
+      params.bonds.parameters.map(\.stretchingStiffness))
+    XCTAssertEqual(reference.angles.indices, params.angles.indices)
+    XCTAssertEqual(reference.angles.map, params.angles.map)
+    XCTAssertEqual(
+      reference.angles.parameters.map(\.equilibriumAngle),
+      params.angles.parameters.map(\.equilibriumAngle))
+    XCTAssertEqual(reference.torsions.indices, params.torsions.indices)
+    XCTAssertEqual(
+      reference.torsions.parameters.map(\.V3),
+      params.torsions.parameters.map(\.V3))
+    XCTAssertEqual(reference.rings.indices, params.rings.indices)
+    XCTAssertEqual(
+      reference.nonbondedExceptions13, params.nonbondedExceptions13)
+    XCTAssertEqual(
+      reference.nonbondedExceptions14, params.nonbondedExceptions14)
+    
+    // A different descriptor must not reuse the entry.
+    paramsDesc.hydrogenMassScale = 1
+    let unscaled = try MM4Parameters(
+      descriptor: paramsDesc, cacheDirectory: cacheDirectory)
+    XCTAssertNotEqual(reference.atoms.masses, unscaled.atoms.masses)
+  }
+  
+  #if DEBUG
+  func testCacheValidation() throws {
+    let url = FileManager.default.temporaryDirectory
+      .appendingPathComponent("MM4ParametersTests-\(UUID().uuidString).mm4p")
+    defer {
+      try? FileManager.default.removeItem(at: url)
+    }
+    
+    let adamantane = Adamantane(atomCode: .silicon)
+    var paramsDesc = MM4ParametersDescriptor()
+    paramsDesc.atomicNumbers = adamantane.atomicNumbers
+    paramsDesc.bonds = adamantane.bonds
+    let reference = try MM4Parameters(descriptor: paramsDesc)
+    try reference.write(to: url, descriptor: paramsDesc)
+    XCTAssertNotNil(MM4Parameters(cacheURL: url, descriptor: paramsDesc))
+    
+    // An entry whose per-atom arrays disagree is rejected.
+    var params = reference
+    params.atoms.masses.removeLast()
+    try params.write(to: url, descriptor: paramsDesc)
+    XCTAssertNil(MM4Parameters(cacheURL: url, descriptor: paramsDesc))
+    
+    // An entry whose angle parameters disagree with the indices is rejected.
+    params = reference
+    params.angles.parameters.removeLast()
+    try params.write(to: url, descriptor: paramsDesc)
+    XCTAssertNil(MM4Parameters(cacheURL: url, descriptor: paramsDesc))
+    
+    // An entry with an atom index out of range is rejected.
+    params = reference
+    params.torsions.indices[0][0] = UInt32(reference.atoms.count)
+    try params.write(to: url, descriptor: paramsDesc)
+    XCTAssertNil(MM4Parameters(cacheURL: url, descriptor: paramsDesc))
+  }
+  #endif
+  
+  func testEdit() throws {
+    let atoms = Base64Decoder.decodeAtoms(NCFPart.base64Atoms)
+    let bonds = Base64Decoder.decodeBonds(NCFPart.base64Bonds)
+    
+    // The edit must inherit the mass scale from the original parameters.
+    var paramsDesc = MM4ParametersDescriptor()
+    paramsDesc.atomicNumbers = atoms.map { UInt8($0.w) }
+    paramsDesc.bonds = bonds
+    paramsDesc.hydrogenMassScale = 1
+    var params = try MM4Parameters(descriptor: paramsDesc)
+    
+    // Replace hydrogens at the start, middle, and end of the part with
+    // fluorines. Only select carbons where every neighboring carbon is an
+    // alkane carbon, which MM4 has fluorine parameters for.
+    func isAlkane(_ atomID: UInt32) -> Bool {
+      for bond in bonds where any(bond .== atomID) {
+        let neighborID = Int(bond[0] == atomID ? bond[1] : bond[0])
+        if params.atoms.atomicNumbers[neighborID] == 6,
+           params.atoms.codes[neighborID] != .alkaneCarbon {
+          return false
+        }
+      }
+      return params.atoms.codes[Int(atomID)] == .alkaneCarbon
+    }
+    let hydrogenBonds = bonds.filter { bond in
+      let atomicNumbers = SIMD2(
+        atoms[Int(bond[0])].w, atoms[Int(bond[1])].w)
+      guard any(atomicNumbers .== 1), any(atomicNumbers .== 6) else {
+        return false
+      }
+      return isAlkane(atomicNumbers[0] == 6 ? bond[0] : bond[1])
+    }
+    XCTAssertGreaterThanOrEqual(hydrogenBonds.count, 3)
+    let selectedBonds = [
+      hydrogenBonds[0],
+      hydrogenBonds[hydrogenBonds.count / 2],
+      hydrogenBonds[hydrogenBonds.count - 1],
+    ]
+    let pairs = selectedBonds.map { bond in
+      (atoms[Int(bond[0])].w == 1) ? bond : SIMD2(bond[1], bond[0])
+    }
+    var edit = MM4ParametersEdit()
+    edit.removedAtoms = pairs.map { $0[0] }
+    let survivingCount = UInt32(atoms.count - edit.removedAtoms.count)
+    for (i, pair) in pairs.enumerated() {
+      let carbonID = pair[1]
+      let removedBefore = edit.removedAtoms.filter { $0 < carbonID }.count
+      edit.addedAtomicNumbers.append(9)
+      edit.addedBonds.append(SIMD2(
+        carbonID - UInt32(removedBefore), survivingCount + UInt32(i)))
+    }
+    
+    // Regenerate the same structure from scratch.
+    let removedSet = Set(edit.removedAtoms)
+    var editedIDs: [UInt32: UInt32] = [:]
+    var atomicNumbers: [UInt8] = []
+    for atomID in atoms.indices where !removedSet.contains(UInt32(atomID)) {
+      editedIDs[UInt32(atomID)] = UInt32(atomicNumbers.count)
+      atomicNumbers.append(UInt8(atoms[atomID].w))
+    }
+    atomicNumbers += edit.addedAtomicNumbers
+    var editedBonds: [SIMD2<UInt32>] = []
+    for bond in bonds {
+      if let atom0 = editedIDs[bond[0]], let atom1 = editedIDs[bond[1]] {
+        editedBonds.append(SIMD2(atom0, atom1))
+      }
+    }
+    editedBonds += edit.addedBonds
+    paramsDesc.atomicNumbers = atomicNumbers
+    paramsDesc.bonds = editedBonds
+    
+    let reference = try MM4Parameters(descriptor: paramsDesc)
+    try params.validate(edit)
+    try params.apply(edit)
+    
+    XCTAssertEqual(reference.atoms.atomicNumbers, params.atoms.atomicNumbers)
+    XCTAssertEqual(reference.atoms.codes, params.atoms.codes)
+    XCTAssertEqual(reference.atoms.masses, params.atoms.masses)
+    XCTAssertEqual(reference.atoms.ringTypes, params.atoms.ringTypes)
+    XCTAssertEqual(
+      reference.atoms.parameters.map(\.charge),
+      params.atoms.parameters.map(\.charge))
+    XCTAssertEqual(reference.bonds.indices, params.bonds.indices)
+    XCTAssertEqual(reference.bonds.map, params.bonds.map)
+    XCTAssertEqual(
+      reference.bonds.parameters.map(\.equilibriumLength),
+      params.bonds.parameters.map(\.equilibriumLength))
+    XCTAssertEqual(reference.angles.indices, params.angles.indices)
+    XCTAssertEqual(
+      reference.angles.parameters.map(\.equilibriumAngle),
+      params.angles.parameters.map(\.equilibriumAngle))
+    XCTAssertEqual(reference.torsions.indices, params.torsions.indices)
+    XCTAssertEqual(reference.rings.indices, params.rings.indices)
+    
+    // Nonbonded exceptions are generated in an arbitrary order.
+    XCTAssertEqual(
+      Set(reference.nonbondedExceptions13), Set(params.nonbondedExceptions13))
+    XCTAssertEqual(
+      Set(reference.nonbondedExceptions14), Set(params.nonbondedExceptions14))
+  }
+  
   func testEmpty() throws {
     var paramsDesc = MM4ParametersDescriptor()
     paramsDesc.atomicNumbers = []
@@ -42,6 +232,38 @@ final class MM4ParametersTests: XCTestCase {
     XCTAssertEqual(0, params.torsions.extendedParameters.count)
   }
   
+  func testFrequency() throws {
+    let adamantane = Adamantane(atomCode: .alkaneCarbon)
+    var frequencies: [Double] = []
+    for hydrogenMassScale in [1, 2, 4] as [Float] {
+      var paramsDesc = MM4ParametersDescriptor()
+      paramsDesc.atomicNumbers = adamantane.atomicNumbers
+      paramsDesc.bonds = adamantane.bonds
+      paramsDesc.hydrogenMassScale = hydrogenMassScale
+      let params = try MM4Parameters(descriptor: paramsDesc)
+      frequencies.append(params.maximumVibrationalFrequency())
+    }
+    
+    // C-H stretching is ~3000 cm^-1, or ~565 rad/ps with unmodified masses.
+    XCTAssertEqual(frequencies[0], 565, accuracy: 60)
+    XCTAssertGreaterThan(frequencies[0], frequencies[1])
+    XCTAssertGreaterThan(frequencies[1], frequencies[2])
+  }
+  
+  func testGroupMap() throws {
+    // Bonds are not sorted, so the map must store a permutation.
+    let adamantane = Adamantane(atomCode: .alkaneCarbon)
+    let bonds = adamantane.bonds.map { SIMD2($0.min(), $0.max()) }
+    let map = MM4GroupMap(bonds)
+    XCTAssertEqual(map.count, bonds.count)
+    for (index, bond) in bonds.enumerated() {
+      XCTAssertEqual(map[bond], UInt32(index))
+    }
+    XCTAssertNil(map[SIMD2(0, 0)])
+    XCTAssertNil(map[SIMD2(UInt32(bonds.count), .max)])
+    XCTAssertNil(MM4GroupMap<SIMD2<UInt32>>()[SIMD2(0, 1)])
+  }
+  
   func testParametersCombination() throws {
     let references = try MM4RigidBodyTests.createRigidBodyReferences()
     try _testParametersCombination(references)
@@ -367,6 +589,36 @@ private func _testParametersCombination(
     combinedParameters.append(contentsOf: reference.parameters)
   }
   
+  // The batched path must produce the same result as appending serially.
+  let concatenatedParameters = MM4Parameters(
+    concatenating: references.map(\.parameters))
+  XCTAssertEqual(
+    combinedParameters.atoms.atomicNumbers,
+    concatenatedParameters.atoms.atomicNumbers)
+  XCTAssertEqual(
+    combinedParameters.atoms.codes, concatenatedParameters.atoms.codes)
+  XCTAssertEqual(
+    combinedParameters.atoms.masses, concatenatedParameters.atoms.masses)
+  XCTAssertEqual(
+    combinedParameters.bonds.indices, concatenatedParameters.bonds.indices)
+  XCTAssertEqual(
+    combinedParameters.bonds.map, concatenatedParameters.bonds.map)
+  XCTAssertEqual(
+    combinedParameters.angles.map, concatenatedParameters.angles.map)
+  XCTAssertEqual(
+    combinedParameters.torsions.map, concatenatedParameters.torsions.map)
+  XCTAssertEqual(
+    combinedParameters.rings.map, concatenatedParameters.rings.map)
+  XCTAssertEqual(
+    combinedParameters.nonbondedExceptions13,
+    concatenatedParameters.nonbondedExceptions13)
+  XCTAssertEqual(
+    combinedParameters.atomsToBondsMap,
+    concatenatedParameters.atomsToBondsMap)
+  XCTAssertEqual(
+    combinedParameters.atomsToAtomsMap,
+    concatenatedParameters.atomsToAtomsMap)
+  
   // The objects are expected to be in the order:
   // - adamantane
   // - sila-adamantane
@@ -0,0 +1,67 @@
+import XCTest
+import MM4
+
+final class MM4TrajectoryTests: XCTestCase {
+  func testTrajectoryRoundTrip() throws {
+    let url = FileManager.default.temporaryDirectory
+      .appendingPathComponent("MM4TrajectoryTests-\(UUID().uuidString).mm4t")
+    defer {
+      try? FileManager.default.removeItem(at: url)
+    }
+    
+    // Generate a random walk, which resembles a real trajectory more closely
+    // than uncorrelated positions.
+    let atomCount = 1000
+    let frameCount = 75
+    var frames: [[SIMD3<Float>]] = []
+    var positions = (0..<atomCount).map { _ in
+      SIMD3<Float>.random(in: -5...5)
+    }
+    for _ in 0..<frameCount {
+      frames.append(positions)
+      for atomID in positions.indices {
+        positions[atomID] += SIMD3<Float>.random(in: -0.01...0.01)
+      }
+    }
+    
+    var descriptor = MM4TrajectoryWriterDescriptor()
+    descriptor.atomCount = atomCount
+    descriptor.keyframeInterval = 16
+    descriptor.url = url
+    let writer = try MM4TrajectoryWriter(descriptor: descriptor)
+    for frameID in frames.indices {
+      try writer.write(
+        positions: frames[frameID], time: 0.04 * Double(frameID))
+    }
+    try writer.close()
+    
+    let reader = try MM4TrajectoryReader(url: url)
+    XCTAssertEqual(reader.atomCount, atomCount)
+    XCTAssertEqual(reader.frameCount, frameCount)
+    
+    // Visit the frames in both sequential and random order.
+    let tolerance = Float(descriptor.resolution) / 2 + 1e-5
+    let order = Array(frames.indices) + frames.indices.shuffled()
+    for frameID in order {
+      XCTAssertEqual(reader.time(frame: frameID), 0.04 * Double(frameID))
+      
+      let decoded = try reader.positions(frame: frameID)
+      let expected = frames[frameID]
+      XCTAssertEqual(decoded.count, expected.count)
+      for atomID in expected.indices {
+        let error = abs(decoded[atomID] - expected[atomID]).max()
+        XCTAssertLessThanOrEqual(error, tolerance)
+      }
+    }
+  }
+  
+  func testTrajectoryIncomplete() throws {
+    let url = FileManager.default.temporaryDirectory
+      .appendingPathComponent("MM4TrajectoryTests-\(UUID().uuidString).mm4t")
+    defer {
+      try? FileManager.default.removeItem(at: url)
+    }
+    try Data(repeating: 0, count: 64).write(to: url)
+    XCTAssertThrowsError(try MM4TrajectoryReader(url: url))
+  }
+}